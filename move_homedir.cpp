@@ -11,16 +11,153 @@
  */
 
 #include <iostream>
+#ifdef _WIN32
 #include "Windows.h"
 #include "Winreg.h"
+#include "Psapi.h"
 
 #include <io.h>
+#endif
 #include <fcntl.h>
 #include <string>
+#ifdef _WIN32
 #include <tchar.h>
+#endif
 #include <stdio.h>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <cwctype>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <memory>
+#include <tuple>
+#include <filesystem>
+#include <ctime>
+#include <optional>
 
-#define DEBUG false
+#ifndef _WIN32
+/*
+ * Stand-ins for the parts of the Windows headers used outside the Windows
+ * backends, so the program builds elsewhere to replay recorded traces.
+ */
+#include <cwchar>
+#include <cstring>
+#include <clocale>
+#include <sys/resource.h>
+
+typedef uint8_t BYTE;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef uint32_t DWORD;
+typedef uint64_t ULONGLONG;
+typedef int BOOL;
+typedef LONG LSTATUS;
+typedef DWORD REGSAM;
+typedef wchar_t WCHAR;
+typedef wchar_t TCHAR;
+typedef BYTE* LPBYTE;
+typedef DWORD* LPDWORD;
+typedef TCHAR* LPTSTR;
+typedef const TCHAR* LPCTSTR;
+typedef void* PVOID;
+typedef struct HKEY__* HKEY;
+typedef HKEY* PHKEY;
+typedef struct _FILETIME {
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME, *PFILETIME;
+
+#define FALSE 0
+#define MAX_PATH 260
+
+#define HKEY_CLASSES_ROOT ((HKEY)(uintptr_t)0x80000000)
+#define HKEY_CURRENT_USER ((HKEY)(uintptr_t)0x80000001)
+#define HKEY_LOCAL_MACHINE ((HKEY)(uintptr_t)0x80000002)
+#define HKEY_USERS ((HKEY)(uintptr_t)0x80000003)
+#define HKEY_CURRENT_CONFIG ((HKEY)(uintptr_t)0x80000005)
+
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_MORE_DATA 234L
+#define ERROR_NO_MORE_ITEMS 259L
+#define ERROR_KEY_DELETED 1018L
+#define ERROR_UNSUPPORTED_TYPE 1630L
+
+#define REG_SZ 1
+#define REG_EXPAND_SZ 2
+#define REG_LINK 6
+#define REG_MULTI_SZ 7
+#define REG_OPTION_OPEN_LINK 0x00000008L
+#define KEY_SET_VALUE 0x0002
+#define KEY_READ 0x20019
+#define KEY_WOW64_64KEY 0x0100
+#define KEY_WOW64_32KEY 0x0200
+#define RRF_RT_REG_SZ 0x00000002
+#define RRF_RT_ANY 0x0000ffff
+#define RRF_NOEXPAND 0x10000000
+
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+#define MOVEFILE_WRITE_THROUGH 0x00000008
+
+#define _tmain wmain
+#define _tcslen wcslen
+#define _tcsicmp wcscasecmp
+#define _tcsnicmp wcsncasecmp
+#define _ttoi(string) ((int)wcstol(string, NULL, 10))
+
+inline void _tcscpy_s(TCHAR* destination, size_t size, const TCHAR* source)
+{
+    wcsncpy(destination, source, size - 1);
+    destination[size - 1] = 0;
+}
+
+inline BOOL DeleteFile(const TCHAR* fileName)
+{
+    std::error_code error;
+    return std::filesystem::remove(fileName, error);
+}
+
+inline BOOL MoveFileEx(const TCHAR* from, const TCHAR* to, DWORD)
+{
+    std::error_code error;
+    std::filesystem::rename(from, to, error);
+    return !error;
+}
+#endif
+
+/* Debug builds keep the diagnostics of the traversal, see TRACE */
+#ifndef TRACE_ENABLED
+#ifdef NDEBUG
+#define TRACE_ENABLED 0
+#else
+#define TRACE_ENABLED 1
+#endif
+#endif
+
+#define KEY_NAME_INFORMATION_CLASS 3
+#define STATUS_BUFFER_OVERFLOW ((NTSTATUS)0x80000005L)
+#define STATUS_BUFFER_TOO_SMALL ((NTSTATUS)0xC0000023L)
+
+#define LINK_VALUE_NAME L"SymbolicLinkValue"
+#define MAX_DEPTH 512
 
 #define MAX_KEY_LENGTH 255
 #define MAX_VALUE_NAME 16383
@@ -29,323 +166,7119 @@
 #define FROM_NAME L"Users\\from"
 #define TO_NAME L"Users\\to"
 
+#define CHECKPOINT_FILE L"move_homedir.checkpoint"
+#define DEFERRED_SUFFIX L"deferred"
+#define DEFERRED_LOG_FILE L"move_homedir.deferred.log"
+#define CHECKPOINT_MAGIC 0x4348564D
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_INTERVAL 30
+
+#define HIGH_VALUE_KEYS { L"Software", L"Microsoft", L"Windows", L"Windows NT", \
+                         L"CurrentVersion", L"Explorer", L"User Shell Folders", \
+                         L"Shell Folders", L"ProfileList", L"Environment", \
+                         L"Volatile Environment", L"App Paths" }
+
+#define LOCATIONS_FILE L"known_locations.txt"
+
+#define FILTER_CACHE_SIZE 4096
+
+#define CONFIDENCE_Z 1.96
+
+#define BACKGROUND_CPU_PERCENT 25
+#define CPU_SAMPLE_KEYS 64
+
+#define REMOTE_WINDOW 8
+#define CONCURRENT_TARGETS 4
+
+#define TRACE_MAGIC 0x5452484D
+#define TRACE_VERSION 1
+#define TRACE_BUFFER 65536
+#define TRACE_MAX_DATA (64 * 1024 * 1024)
+
+#define VALUE_READ_RETRIES 3
+
+#define LATENCY_SAMPLES 100000
+#define SPIN_DELAY_MS 2
+
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BITS 40
+
+#define LOG_RING_SIZE 65536
+#define LOG_INTERVAL_MS 20
+
+#define REPORT_BUFFER (1024 * 1024)
+
+#define TIMELINE_SUBTREE_DEPTH 3
+#define TIMELINE_MIN_US 20
+#define TIMELINE_MAX_SPANS 1000000
+
+#define PROGRESS_INTERVAL_MS 250
+#define PROGRESS_SMOOTHING 0.3
+
+#define METRICS_INTERVAL 15
+
+#define BENCHMARK_PROFILES { \
+    { L"baseline", L"", -1 }, \
+    { L"slow-keys", L"open=lognormal:0.05:2", -1 }, \
+    { L"denied-storm", L"open=denied:0.001:200", -1 }, \
+    { L"more-data", L"enumvalue=moredata:0.1,getvalue=moredata:0.1", -1 }, \
+    { L"changing-hive", L"enumkey=changed:0.0005,enumvalue=changed:0.0005", -1 }, \
+    { L"remote", L"*=lognormal:0.5:0.5", REMOTE_WINDOW } }
+
 /**
- * @class   RegKey
+ * @fn  size_t encodeUtf8(const wchar_t* text, size_t length, size_t& i, char* bytes)
  *
- * @brief   Representation of a key in the registry.
+ * @brief   Encodes one character of a wide string as UTF-8
  *
- * @date    2018.03.16.
+ * A surrogate pair of a 16-bit wide string is encoded as one character.
+ *
+ * @date    2026.10.16.
+ *
+ * @param           text    The wide string.
+ * @param           length  The length of the wide string.
+ * @param [in,out]  i       Index of the character, moved to the second half of a surrogate pair.
+ * @param [out]     bytes   Room for the up to 4 bytes of the encoded character.
+ *
+ * @return  The number of bytes written.
  */
 
-class RegKey {
-    /** @brief  The depth of the current key. Used to detect stack overflow. */
-    int depth;
-    /** @brief  The error code of the registry API */
-    DWORD errorCode;
-    /** @brief  Evaulates whether the key was successfully opened */
-    bool isValidb;
-    /** @brief  Handle of the key */
-    HKEY key;
-    /** @brief  The name of the key */
-    TCHAR name[NAME_BUFFER];
-    /** @brief  Number of subkeys of the key */
-    DWORD subkeyCount;
-    /** @brief  Size of the longest subkey */
-    DWORD longestSubkeySize;
-    /** @brief  Size of the longest subclass */
-    DWORD longestSubClassSize;
-    /** @brief  Number of values */
-    DWORD valueCount;
-    /** @brief  Length of the name of the longest value */
-    DWORD longestValueName;
-    /** @brief  Information describing the longest value */
-    DWORD longestValueData;
-    /** @brief  Size of the security descriptor */
-    DWORD securityDescriptorSize;
-    /** @brief  The last write time */
-    FILETIME lastWriteTime;
+size_t encodeUtf8(const wchar_t* text, size_t length, size_t& i, char* bytes)
+{
+    uint32_t code = (uint32_t)text[i];
+    if (sizeof(wchar_t) == 2 && code >= 0xD800 && code < 0xDC00 && i + 1 < length) {
+        code = 0x10000 + ((code - 0xD800) << 10) + ((uint32_t)text[++i] - 0xDC00);
+    }
+    if (code < 0x80) {
+        bytes[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        bytes[0] = (char)(0xC0 | (code >> 6));
+        bytes[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+    if (code < 0x10000) {
+        bytes[0] = (char)(0xE0 | (code >> 12));
+        bytes[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+    bytes[0] = (char)(0xF0 | (code >> 18));
+    bytes[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    bytes[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    bytes[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+/**
+ * @enum    Phase
+ *
+ * @brief   The parts of a scan shown on the timeline.
+ */
+
+enum Phase {
+    PHASE_HIVE,
+    PHASE_SUBTREE,
+    PHASE_LOCATIONS,
+    PHASE_OPEN,
+    PHASE_ENUMERATE,
+    PHASE_FETCH,
+    PHASE_MATCH,
+    PHASE_WRITE,
+    PHASE_CHECKPOINT,
+    PHASE_LOGGING,
+    PHASE_COUNT
+};
+
+/** @brief  The names of the phases on the timeline */
+static const char* const phaseNames[] = { "hive", "subtree", "known locations", "open", "enumerate",
+                                          "fetch", "match", "write", "checkpoint", "logging"
+                                        };
+
+/**
+ * @class   Timeline
+ *
+ * @brief   Records how long each thread spends in each phase, for chrome://tracing or Perfetto.
+ *
+ * Every thread appends its spans to its own buffer, which only it
+ * changes, so recording takes no lock. Hives, known locations and the
+ * subtrees down to TIMELINE_SUBTREE_DEPTH are always recorded. Shorter
+ * phases, which happen for every key or value, are recorded from
+ * TIMELINE_MIN_US microseconds on and otherwise only added to the totals
+ * of their phase, so the timeline stays readable. A buffer holds at most
+ * TIMELINE_MAX_SPANS spans, later ones only count towards the totals.
+ * Unless enabled, a span costs one test of a flag.
+ *
+ * @date    2026.10.16.
+ */
+
+class Timeline {
+    /**
+     * @struct  Span
+     *
+     * @brief   A phase of one thread.
+     */
+
+    struct Span {
+        Phase phase;
+        /** @brief  Start in nanoseconds since the timeline was enabled */
+        uint64_t start;
+        uint64_t duration;
+        /** @brief  The hive or key path, empty for the shorter phases */
+        std::wstring detail;
+    };
+
+    /**
+     * @struct  Buffer
+     *
+     * @brief   The spans of one thread.
+     */
+
+    struct Buffer {
+        /** @brief  Number of the thread on the timeline */
+        int thread;
+        std::string name;
+        std::vector<Span> spans;
+        /** @brief  Number of spans not recorded because the buffer was full */
+        uint64_t dropped = 0;
+        /** @brief  Time spent in each phase in nanoseconds, recorded or not */
+        uint64_t totals[PHASE_COUNT] = {};
+    };
+
+    /** @brief  True while spans are recorded */
+    bool enabled = false;
+    /** @brief  The time the timeline starts at */
+    std::chrono::steady_clock::time_point origin;
+    /** @brief  Guards the list of buffers */
+    std::mutex mutex;
+    /** @brief  The buffers of the threads which recorded spans */
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer& localBuffer()
+    {
+        thread_local Buffer* buffer = NULL;
+        if (buffer == NULL) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(std::unique_ptr<Buffer>(new Buffer()));
+            buffer = buffers.back().get();
+            buffer->thread = (int)buffers.size();
+            buffer->name = "scan";
+        }
+        return *buffer;
+    }
+
+    static void writeString(std::ostream& stream, const std::wstring& text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        stream << '"';
+        for (size_t i = 0; i < text.length(); i++) {
+            if (text[i] == L'"' || text[i] == L'\\') {
+                stream << '\\' << (char)text[i];
+            }
+            else if (text[i] < 0x20) {
+                stream << "\\u00" << hex[text[i] >> 4] << hex[text[i] & 0xF];
+            }
+            else {
+                char bytes[4];
+                stream.write(bytes, encodeUtf8(text.c_str(), text.length(), i, bytes));
+            }
+        }
+        stream << '"';
+    }
 public:
 
     /**
-     * @fn  RegKey(HKEY parent, TCHAR* name, int depth)
+     * @fn  void enable()
      *
-     * @brief   Creates a new registry key under the parent key
+     * @brief   Starts recording. Called before the threads which record are started.
      *
-     * @date    2018.03.16.
+     * @date    2026.10.16.
+     */
+
+    void enable()
+    {
+        origin = std::chrono::steady_clock::now();
+        enabled = true;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    std::chrono::steady_clock::time_point getOrigin() const
+    {
+        return origin;
+    }
+
+    /**
+     * @fn  void nameThread(const char* name)
      *
-     * @param           parent  Handle of the parent.
-     * @param [in,out]  name    If non-null, the name.
-     * @param           depth   The depth of the key from the root of the hive
+     * @brief   Names the calling thread on the timeline
+     *
+     * @date    2026.10.16.
+     *
+     * @param   name    The name.
      */
 
-    RegKey(HKEY parent, TCHAR* name, int depth)
+    void nameThread(const char* name)
     {
-        this->depth = depth;
-        _tcscpy_s(this->name, NAME_BUFFER, name);
-        errorCode = RegOpenKeyEx(parent, name, 0, KEY_ALL_ACCESS | KEY_WOW64_64KEY,
-                                 &key);
-        isValidb = (errorCode == ERROR_SUCCESS);
-        if (isValidb) {
-            getInfo();
+        if (enabled) {
+            localBuffer().name = name;
         }
-        else {
-            if (errorCode == ERROR_ACCESS_DENIED && DEBUG) {
-                std::wcout << "Access denied. Are you an administrator?" << "\n";
+    }
+
+    /**
+     * @fn  void record(Phase phase, std::chrono::steady_clock::time_point start,
+     *                  const std::wstring& detail)
+     *
+     * @brief   Records a phase of the calling thread which ends now
+     *
+     * @date    2026.10.16.
+     *
+     * @param   phase   The phase.
+     * @param   start   The time the phase started.
+     * @param   detail  The hive or key path, empty if there is none.
+     */
+
+    void record(Phase phase, std::chrono::steady_clock::time_point start, const std::wstring& detail)
+    {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        Buffer& buffer = localBuffer();
+        buffer.totals[phase] += duration;
+        if (phase > PHASE_LOCATIONS && duration < TIMELINE_MIN_US * 1000) {
+            return;
+        }
+        if (buffer.spans.size() >= TIMELINE_MAX_SPANS) {
+            buffer.dropped++;
+            return;
+        }
+        buffer.spans.push_back(Span{ phase, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>
+                                     (start - origin).count(), duration, detail });
+    }
+
+    /**
+     * @fn  bool write(const std::wstring& fileName)
+     *
+     * @brief   Writes the spans as Chrome trace events. Only called while no span is recorded.
+     *
+     * The totals of the phases and the spans dropped are added as metadata.
+     *
+     * @date    2026.10.16.
+     *
+     * @param   fileName    The file written.
+     *
+     * @return  True if it succeeds, false if the file could not be written.
+     */
+
+    bool write(const std::wstring& fileName)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream file(std::filesystem::path(fileName), std::ios::trunc);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << std::fixed << std::setprecision(3);
+        const char* separator = "";
+        uint64_t totals[PHASE_COUNT] = {}, dropped = 0;
+        for (const std::unique_ptr<Buffer>& buffer : buffers) {
+            file << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" <<
+                 buffer->thread << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+            separator = ",\n";
+            for (const Span& span : buffer->spans) {
+                file << separator << "{\"name\":\"" << phaseNames[span.phase] <<
+                     "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread << ",\"ts\":" <<
+                     span.start / 1000.0 << ",\"dur\":" << span.duration / 1000.0;
+                if (!span.detail.empty()) {
+                    file << ",\"args\":{\"path\":";
+                    writeString(file, span.detail);
+                    file << "}";
+                }
+                file << "}";
             }
-            else if (errorCode != ERROR_FILE_NOT_FOUND && DEBUG) {
-                std::wcout << "Error during key open: " << errorCode << "\n";
+            for (int i = 0; i < PHASE_COUNT; i++) {
+                totals[i] += buffer->totals[i];
             }
+            dropped += buffer->dropped;
+        }
+        file << "\n],\"otherData\":{\"dropped_spans\":\"" << dropped << "\"";
+        for (int i = PHASE_OPEN; i < PHASE_COUNT; i++) {
+            file << ",\"" << phaseNames[i] << "_ms\":\"" << totals[i] / 1e6 << "\"";
+        }
+        file << "}}\n";
+        file.close();
+        return !file.fail();
+    }
+};
+
+/** @brief  The phases of the scan, recorded with --timeline */
+static Timeline timeline;
+
+/**
+ * @class   PhaseSpan
+ *
+ * @brief   Records the time until it goes out of scope as a phase of the calling thread.
+ *
+ * @date    2026.10.16.
+ */
+
+class PhaseSpan {
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+    std::wstring detail;
+public:
+    explicit PhaseSpan(Phase phase) : phase(phase)
+    {
+        if (timeline.isEnabled()) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    PhaseSpan(Phase phase, const std::wstring& detail) : phase(phase)
+    {
+        if (timeline.isEnabled()) {
+            this->detail = detail;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseSpan()
+    {
+        if (timeline.isEnabled()) {
+            timeline.record(phase, start, detail);
         }
     }
 
     /**
-     * @fn  ~RegKey()
+     * @fn  void next(Phase phase)
      *
-     * @brief   Closes the key if it was opened successfully in the first place
+     * @brief   Ends the current phase and starts another one
      *
-     * @date    2018.03.16.
+     * @date    2026.10.16.
+     *
+     * @param   phase   The phase which starts.
      */
 
-    ~RegKey()
+    void next(Phase phase)
     {
-        if (isValidb) {
-            RegCloseKey(key);
+        if (phase == this->phase) {
+            return;
+        }
+        if (timeline.isEnabled()) {
+            timeline.record(this->phase, start, detail);
+            start = std::chrono::steady_clock::now();
+        }
+        this->phase = phase;
+    }
+};
+
+/**
+ * @enum    SlowKind
+ *
+ * @brief   The operations whose slowest instances are kept.
+ */
+
+enum SlowKind {
+    /** @brief  Opening a key, with its information in info mode */
+    SLOW_OPEN,
+    /** @brief  Enumerating the subkeys of a key */
+    SLOW_ENUMERATE,
+    /** @brief  Reading a value */
+    SLOW_VALUE,
+    SLOW_KINDS
+};
+
+/**
+ * @class   SlowestOperations
+ *
+ * @brief   Keeps the slowest key opens, enumerations and value reads of the scan.
+ *
+ * Every thread keeps its own bounded min-heaps, so recording takes no
+ * lock, and the path of an operation is only built when it is among the
+ * slowest so far. The heaps are merged when they are printed.
+ *
+ * @date    2026.10.16.
+ */
+
+class SlowestOperations {
+    /**
+     * @struct  Operation
+     *
+     * @brief   One slow operation.
+     */
+
+    struct Operation {
+        uint64_t duration;
+        std::wstring path;
+        /** @brief  Number of subkeys of an enumeration, bytes of a value */
+        uint64_t size;
+
+        bool operator>(const Operation& other) const
+        {
+            return duration > other.duration;
+        }
+    };
+
+    /**
+     * @struct  Heaps
+     *
+     * @brief   The slowest operations of one thread, the fastest of them on top.
+     */
+
+    struct Heaps {
+        std::vector<Operation> heaps[SLOW_KINDS];
+    };
+
+    /** @brief  Number of operations kept of each kind, 0 if disabled */
+    size_t limit = 0;
+    /** @brief  Guards the list of heaps */
+    std::mutex mutex;
+    /** @brief  The heaps of the threads which recorded operations */
+    std::vector<std::unique_ptr<Heaps>> buffers;
+
+    Heaps& localHeaps()
+    {
+        thread_local Heaps* heaps = NULL;
+        if (heaps == NULL) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(std::unique_ptr<Heaps>(new Heaps()));
+            heaps = buffers.back().get();
         }
+        return *heaps;
     }
+public:
 
     /**
-     * @fn  void getInfo()
+     * @fn  void enable(size_t limit)
      *
-     * @brief   Retrieves metadata of the key (used for subkey count mainly)
+     * @brief   Starts keeping the slowest operations. Called before the scan.
      *
-     * @date    2018.03.16.
+     * @date    2026.10.16.
+     *
+     * @param   limit   Number of operations kept of each kind.
+     */
+
+    void enable(size_t limit)
+    {
+        this->limit = limit;
+    }
+
+    bool isEnabled() const
+    {
+        return limit > 0;
+    }
+
+    /**
+     * @fn  std::chrono::steady_clock::time_point start() const
+     *
+     * @brief   Marks the start of an operation, without reading the clock if disabled
+     *
+     * @date    2026.10.16.
+     *
+     * @return  The current time, or the epoch of the clock if disabled.
+     */
+
+    std::chrono::steady_clock::time_point start() const
+    {
+        return (limit > 0) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    }
+
+    /**
+     * @fn  void record(SlowKind kind, std::chrono::steady_clock::time_point start,
+     *                  const std::wstring& path, const wchar_t* name, uint64_t size)
+     *
+     * @brief   Keeps an operation which ends now if it is among the slowest
+     *
+     * @date    2026.10.16.
+     *
+     * @param   kind    The kind of the operation.
+     * @param   start   The start of the operation.
+     * @param   path    The path of the key, or of the parent if a name is given.
+     * @param   name    The name of the subkey or value, or null.
+     * @param   size    Number of subkeys of an enumeration, bytes of a value, 0 otherwise.
+     */
+
+    void record(SlowKind kind, std::chrono::steady_clock::time_point start,
+                const std::wstring& path, const wchar_t* name, uint64_t size)
+    {
+        if (limit == 0) {
+            return;
+        }
+        uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>
+                            (std::chrono::steady_clock::now() - start).count();
+        std::vector<Operation>& heap = localHeaps().heaps[kind];
+        if (heap.size() == limit) {
+            if (duration <= heap.front().duration) {
+                return;
+            }
+            std::pop_heap(heap.begin(), heap.end(), std::greater<Operation>());
+            heap.pop_back();
+        }
+        heap.push_back(Operation{ duration, name != NULL ? path + L"\\" + name : path, size });
+        std::push_heap(heap.begin(), heap.end(), std::greater<Operation>());
+    }
+
+    /**
+     * @fn  void print()
+     *
+     * @brief   Merges the heaps of the threads and prints the slowest operations of each kind
+     *
+     * Only called while no operation is recorded.
+     *
+     * @date    2026.10.16.
      */
 
-    void getInfo()
-    {
-        RegQueryInfoKey(
-            key,                     // key handle
-            NULL,                    // buffer for class name
-            NULL,                    // size of class string
-            NULL,                    // reserved
-            &subkeyCount,            // number of subkeys
-            &longestSubkeySize,      // longest subkey size
-            &longestSubClassSize,    // longest class string
-            &valueCount,             // number of values for this key
-            &longestValueName,       // longest value name
-            &longestValueData,       // longest value data
-            &securityDescriptorSize, // security descriptor
-            &lastWriteTime);         // last write time
+    void print()
+    {
+        static const char* const titles[] = { "Slowest key opens:", "Slowest enumerations:",
+                                              "Slowest value reads:"
+                                            };
+        static const char* const units[] = { "", " subkeys", " bytes" };
+        std::lock_guard<std::mutex> lock(mutex);
+        std::streamsize precision = std::wcout.precision();
+        for (int kind = 0; kind < SLOW_KINDS; kind++) {
+            std::vector<Operation> merged;
+            for (const std::unique_ptr<Heaps>& buffer : buffers) {
+                merged.insert(merged.end(), buffer->heaps[kind].begin(), buffer->heaps[kind].end());
+            }
+            std::sort(merged.begin(), merged.end(), std::greater<Operation>());
+            merged.resize(std::min(merged.size(), limit));
+            std::wcout << titles[kind] << "\n";
+            for (const Operation& operation : merged) {
+                std::wcout << std::fixed << std::setprecision(1) << std::setw(12) <<
+                           operation.duration / 1e3 << " us  " << operation.path;
+                if (kind != SLOW_OPEN) {
+                    std::wcout << " (" << operation.size << units[kind] << ")";
+                }
+                std::wcout << "\n";
+            }
+        }
+        std::wcout << std::defaultfloat << std::setprecision(precision);
+    }
+};
+
+/** @brief  The slowest operations of the scan, kept with --top */
+static SlowestOperations slowest;
+
+/**
+ * @enum    LogLevel
+ *
+ * @brief   How much the scan reports, every level includes the ones before it.
+ */
+
+enum LogLevel {
+    /** @brief  Nothing */
+    LOG_OFF,
+    /** @brief  Failures */
+    LOG_ERROR,
+    /** @brief  Problems the scan continues after, e.g. values it was not allowed to replace */
+    LOG_WARNING,
+    /** @brief  Replacements and summaries */
+    LOG_INFO,
+    /** @brief  Every key and value visited */
+    LOG_DEBUG,
+    /** @brief  Diagnostics, only available when built with TRACE_ENABLED */
+    LOG_TRACE
+};
+
+/**
+ * @struct  LogRing
+ *
+ * @brief   Text written by one thread and not yet taken by the writer thread.
+ */
+
+struct LogRing {
+    /** @brief  The characters, indexed modulo LOG_RING_SIZE */
+    std::vector<wchar_t> buffer = std::vector<wchar_t>(LOG_RING_SIZE);
+    /** @brief  Number of characters ever added, only changed by the owning thread */
+    std::atomic<size_t> head{0};
+    /** @brief  Number of characters ever taken, only changed by the writer thread */
+    std::atomic<size_t> tail{0};
+};
+
+/**
+ * @class   Logger
+ *
+ * @brief   Writes the output of the scan on a background thread.
+ *
+ * Every thread appends its lines to its own LogRing without taking a lock
+ * or making a system call. A message becomes visible to the writer only
+ * once all of it is in the ring, so the messages of different threads are
+ * never mixed within a line. The writer thread collects the rings every
+ * LOG_INTERVAL_MS milliseconds, or sooner when one fills up, and writes
+ * what it found as one block to the console or the log file. Until the
+ * writer is started, lines are written directly.
+ *
+ * @date    2026.10.16.
+ */
+
+class Logger {
+    /** @brief  The most detailed level written, read by every thread which logs */
+    std::atomic<LogLevel> level{LOG_INFO};
+    /** @brief  The log file, or null for the console */
+    FILE* file = NULL;
+    /** @brief  Guards the list of rings and the wakeups */
+    std::mutex mutex;
+    /** @brief  Wakes the writer thread early */
+    std::condition_variable wakeup;
+    /** @brief  Wakes the threads waiting for the output to be written */
+    std::condition_variable written;
+    /** @brief  The rings of the threads which wrote lines */
+    std::vector<std::unique_ptr<LogRing>> rings;
+    /** @brief  Number of characters added but not written yet */
+    std::atomic<size_t> pending{0};
+    /** @brief  True while the writer thread runs */
+    std::atomic<bool> running{false};
+    std::thread writer;
+
+    LogRing& localRing()
+    {
+        thread_local LogRing* ring = NULL;
+        if (ring == NULL) {
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.push_back(std::unique_ptr<LogRing>(new LogRing()));
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    void output(const std::wstring& text)
+    {
+        if (file == NULL) {
+            fputws(text.c_str(), stdout);
+            fflush(stdout);
+            return;
+        }
+        /* The log file is UTF-8, whatever the size of the local wide characters */
+        std::string encoded;
+        encoded.reserve(text.length());
+        for (size_t i = 0; i < text.length(); i++) {
+            char bytes[4];
+            encoded.append(bytes, encodeUtf8(text.c_str(), text.length(), i, bytes));
+        }
+        fwrite(encoded.data(), 1, encoded.size(), file);
+        fflush(file);
+    }
+
+    /* Body of the writer thread */
+    void run()
+    {
+        timeline.nameThread("logger");
+        std::wstring block;
+        while (running || pending > 0) {
+            block.clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (const std::unique_ptr<LogRing>& ring : rings) {
+                    size_t head = ring->head.load(std::memory_order_acquire);
+                    for (size_t i = ring->tail.load(std::memory_order_relaxed); i < head; i++) {
+                        block += ring->buffer[i % LOG_RING_SIZE];
+                    }
+                    ring->tail.store(head, std::memory_order_release);
+                }
+            }
+            if (!block.empty()) {
+                {
+                    PhaseSpan span(PHASE_LOGGING);
+                    output(block);
+                }
+                pending -= block.length();
+                written.notify_all();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait_for(lock, std::chrono::milliseconds(LOG_INTERVAL_MS));
+        }
+    }
+public:
+    ~Logger()
+    {
+        stop();
+    }
+
+    /**
+     * @fn  bool start(LogLevel level, const std::wstring& fileName)
+     *
+     * @brief   Starts the writer thread
+     *
+     * @date    2026.10.16.
+     *
+     * @param   level       The most detailed level written.
+     * @param   fileName    The log file, empty for the console.
+     *
+     * @return  True if it succeeds, false if the log file could not be created.
+     */
+
+    bool start(LogLevel level, const std::wstring& fileName)
+    {
+        this->level.store(level, std::memory_order_relaxed);
+        if (!fileName.empty()) {
+#ifdef _WIN32
+            file = _wfopen(fileName.c_str(), L"wb");
+#else
+            file = fopen(std::filesystem::path(fileName).c_str(), "wb");
+#endif
+            if (file == NULL) {
+                return false;
+            }
+        }
+        running = true;
+        writer = std::thread(&Logger::run, this);
+        return true;
+    }
+
+    /**
+     * @fn  void stop()
+     *
+     * @brief   Writes what is left and stops the writer thread
+     *
+     * @date    2026.10.16.
+     */
+
+    void stop()
+    {
+        if (!running) {
+            return;
+        }
+        running = false;
+        wakeup.notify_one();
+        writer.join();
+        if (file != NULL) {
+            fclose(file);
+            file = NULL;
+        }
+    }
+
+    bool enabled(LogLevel level) const
+    {
+        return level <= this->level.load(std::memory_order_relaxed);
+    }
+
+    LogLevel getLevel() const
+    {
+        return level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @fn  void setLevel(LogLevel level)
+     *
+     * @brief   Changes the most detailed level written, other threads may be logging meanwhile
+     *
+     * @date    2026.10.16.
+     *
+     * @param   level   The level.
+     */
+
+    void setLevel(LogLevel level)
+    {
+        this->level.store(level, std::memory_order_relaxed);
+    }
+
+    /**
+     * @fn  void write(const std::wstring& text)
+     *
+     * @brief   Appends text to the ring of the calling thread
+     *
+     * Waits for the writer thread only if the ring has no room for the
+     * whole text. A text longer than the ring is handed over in pieces of
+     * the size of the ring.
+     *
+     * @date    2026.10.16.
+     *
+     * @param   text    The text.
+     */
+
+    void write(const std::wstring& text)
+    {
+        if (!running) {
+            output(text);
+            return;
+        }
+        LogRing& ring = localRing();
+        pending += text.length();
+        for (size_t done = 0; done < text.length();) {
+            size_t head = ring.head.load(std::memory_order_relaxed);
+            size_t room = LOG_RING_SIZE - (head - ring.tail.load(std::memory_order_acquire));
+            size_t count = std::min(text.length() - done, (size_t)LOG_RING_SIZE);
+            if (room < count) {
+                wakeup.notify_one();
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < count; i++) {
+                ring.buffer[(head + i) % LOG_RING_SIZE] = text[done + i];
+            }
+            ring.head.store(head + count, std::memory_order_release);
+            done += count;
+            if (room - count < LOG_RING_SIZE / 2) {
+                wakeup.notify_one();
+            }
+        }
+    }
+
+    /**
+     * @fn  void flush()
+     *
+     * @brief   Waits until everything logged so far is written
+     *
+     * @date    2026.10.16.
+     */
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running && pending > 0) {
+            wakeup.notify_one();
+            written.wait_for(lock, std::chrono::milliseconds(LOG_INTERVAL_MS));
+        }
+    }
+};
+
+/** @brief  The output of the scan */
+static Logger logger;
+
+/**
+ * @class   LogLine
+ *
+ * @brief   Formats one message and hands it to the logger when it goes out of scope.
+ *
+ * Use it through LOG, which skips the formatting if the level is not written.
+ *
+ * @date    2026.10.16.
+ */
+
+class LogLine {
+    std::wostringstream& stream;
+
+    static std::wostringstream& localStream()
+    {
+        thread_local std::wostringstream stream;
+        return stream;
+    }
+public:
+    LogLine() : stream(localStream())
+    {
+        stream.str(std::wstring());
+        stream.clear();
+    }
+
+    ~LogLine()
+    {
+        logger.write(stream.str());
+    }
+
+    template <typename T>
+    LogLine& operator<<(const T& value)
+    {
+        stream << value;
+        return *this;
+    }
+};
+
+#define LOG(level) if (!logger.enabled(level)) {} else LogLine()
+
+/*
+ * Diagnostics of the traversal. Without TRACE_ENABLED the condition is a
+ * constant, so the message is compiled but never formatted or evaluated.
+ */
+#define TRACE if (!TRACE_ENABLED || !logger.enabled(LOG_TRACE)) {} else LogLine()
+
+/**
+ * @class   RegistryBackend
+ *
+ * @brief   Access to a registry, every registry call of the traversal goes through it.
+ *
+ * The public functions count the calls and forward them to the
+ * implementation, which mirrors the corresponding Win32 function.
+ *
+ * @date    2026.10.16.
+ */
+
+struct CallStatistics;
+
+class RegistryBackend {
+    /** @brief  Number of registry calls made through the backend */
+    std::atomic<unsigned long long> calls;
+    /** @brief  Enumerate until ERROR_NO_MORE_ITEMS instead of querying the key first */
+    bool probing;
+protected:
+    virtual LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam,
+                              PHKEY result) = 0;
+    virtual LSTATUS doCloseKey(HKEY key) = 0;
+    virtual LSTATUS doQueryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey,
+                                   LPDWORD values, LPDWORD longestValueName,
+                                   LPDWORD longestValueData, PFILETIME lastWriteTime) = 0;
+    virtual LSTATUS doEnumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength) = 0;
+    virtual LSTATUS doEnumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength,
+                                LPDWORD type, LPBYTE data, LPDWORD dataSize) = 0;
+    virtual LSTATUS doGetValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                               LPDWORD dataSize) = 0;
+    virtual LSTATUS doSetValue(HKEY key, LPCTSTR name, DWORD type, const BYTE* data,
+                               DWORD dataSize) = 0;
+    virtual std::wstring doPhysicalName(HKEY key) = 0;
+public:
+
+    RegistryBackend()
+    {
+        calls = 0;
+        probing = true;
+    }
+
+    virtual ~RegistryBackend() {}
+
+    /**
+     * @fn  virtual bool probesByDefault()
+     *
+     * @brief   Query which enumeration strategy is cheaper for the backend
+     *
+     * Probing saves a RegQueryInfoKey per key and reads the value data
+     * together with the names, at the cost of one ERROR_NO_MORE_ITEMS call
+     * per loop and occasional buffer growth.
+     *
+     * @date    2026.10.16.
+     *
+     * @return  True if enumerating until ERROR_NO_MORE_ITEMS is preferred.
+     */
+
+    virtual bool probesByDefault()
+    {
+        return true;
+    }
+
+    /**
+     * @fn  virtual bool hasHive(HKEY hive)
+     *
+     * @brief   Query whether a hive can be opened through the backend
+     *
+     * @date    2026.10.16.
+     *
+     * @param   hive    Predefined handle of the hive.
+     *
+     * @return  True if the hive is available.
+     */
+
+    virtual bool hasHive(HKEY)
+    {
+        return true;
+    }
+
+    /**
+     * @fn  virtual int defaultPrefetch()
+     *
+     * @brief   Number of siblings to open ahead unless --prefetch is given
+     *
+     * @date    2026.10.16.
+     *
+     * @return  The depth of the prefetch window, 0 disables prefetching.
+     */
+
+    virtual int defaultPrefetch()
+    {
+        return 0;
+    }
+
+    /**
+     * @fn  virtual void printStatistics()
+     *
+     * @brief   Prints what the backend knows about the cost of the scan
+     *
+     * @date    2026.10.16.
+     */
+
+    virtual void printStatistics() {}
+
+    /**
+     * @fn  virtual bool getCallStatistics(CallStatistics& statistics)
+     *
+     * @brief   Adds up the counts and durations of the calls made so far, if the backend keeps them
+     *
+     * @date    2026.10.16.
+     *
+     * @param [out] statistics  The statistics of all calls.
+     *
+     * @return  False if the backend does not keep statistics.
+     */
+
+    virtual bool getCallStatistics(CallStatistics&)
+    {
+        return false;
+    }
+
+    bool isProbing()
+    {
+        return probing;
+    }
+
+    void setProbing(bool probing)
+    {
+        this->probing = probing;
+    }
+
+    unsigned long long getCallCount()
+    {
+        return calls;
+    }
+
+    LSTATUS openKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        calls++;
+        return doOpenKey(parent, name, options, sam, result);
+    }
+
+    LSTATUS closeKey(HKEY key)
+    {
+        calls++;
+        return doCloseKey(key);
+    }
+
+    LSTATUS queryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey, LPDWORD values,
+                         LPDWORD longestValueName, LPDWORD longestValueData,
+                         PFILETIME lastWriteTime)
+    {
+        calls++;
+        return doQueryInfoKey(key, subkeys, longestSubkey, values, longestValueName,
+                              longestValueData, lastWriteTime);
+    }
+
+    LSTATUS enumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength)
+    {
+        calls++;
+        return doEnumKey(key, index, name, nameLength);
+    }
+
+    LSTATUS enumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength, LPDWORD type,
+                      LPBYTE data, LPDWORD dataSize)
+    {
+        calls++;
+        return doEnumValue(key, index, name, nameLength, type, data, dataSize);
+    }
+
+    LSTATUS getValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                     LPDWORD dataSize)
+    {
+        calls++;
+        return doGetValue(key, name, flags, type, data, dataSize);
+    }
+
+    LSTATUS setValue(HKEY key, LPCTSTR name, DWORD type, const BYTE* data, DWORD dataSize)
+    {
+        calls++;
+        return doSetValue(key, name, type, data, dataSize);
+    }
+
+    /**
+     * @fn  std::wstring physicalName(HKEY key)
+     *
+     * @brief   Retrieves the name of a key in the kernel object namespace
+     *
+     * Unlike the path the key was opened with, this name is the same for
+     * every alias of the key, e.g. HKEY_CURRENT_USER is resolved to
+     * \REGISTRY\USER\<SID>.
+     *
+     * @date    2026.10.16.
+     *
+     * @param   key The handle of the key.
+     *
+     * @return  The physical name, or an empty string if it is not available.
+     */
+
+    std::wstring physicalName(HKEY key)
+    {
+        calls++;
+        return doPhysicalName(key);
+    }
+};
+
+#ifdef _WIN32
+/**
+ * @class   Win32Backend
+ *
+ * @brief   The registry of the local machine, accessed through the Win32 API.
+ *
+ * @date    2026.10.16.
+ */
+
+class Win32Backend : public RegistryBackend {
+protected:
+    LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        return RegOpenKeyEx(parent, name, options, sam, result);
+    }
+
+    LSTATUS doCloseKey(HKEY key)
+    {
+        return RegCloseKey(key);
+    }
+
+    LSTATUS doQueryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey, LPDWORD values,
+                           LPDWORD longestValueName, LPDWORD longestValueData,
+                           PFILETIME lastWriteTime)
+    {
+        return RegQueryInfoKey(
+                   key,                     // key handle
+                   NULL,                    // buffer for class name
+                   NULL,                    // size of class string
+                   NULL,                    // reserved
+                   subkeys,                 // number of subkeys
+                   longestSubkey,           // longest subkey size
+                   NULL,                    // longest class string
+                   values,                  // number of values for this key
+                   longestValueName,        // longest value name
+                   longestValueData,        // longest value data
+                   NULL,                    // security descriptor
+                   lastWriteTime);          // last write time
+    }
+
+    LSTATUS doEnumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength)
+    {
+        return RegEnumKeyEx(key, index, name, nameLength, NULL, NULL, NULL, NULL);
+    }
+
+    LSTATUS doEnumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength, LPDWORD type,
+                        LPBYTE data, LPDWORD dataSize)
+    {
+        return RegEnumValue(key, index, name, nameLength, NULL, type, data, dataSize);
+    }
+
+    LSTATUS doGetValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                       LPDWORD dataSize)
+    {
+        return RegGetValue(key, NULL, name, flags, type, data, dataSize);
+    }
+
+    LSTATUS doSetValue(HKEY key, LPCTSTR name, DWORD type, const BYTE* data, DWORD dataSize)
+    {
+        return RegSetValueEx(key, name, 0, type, data, dataSize);
+    }
+
+    std::wstring doPhysicalName(HKEY key)
+    {
+        typedef NTSTATUS (NTAPI *NtQueryKeyFunction)(HANDLE, int, PVOID, ULONG, PULONG);
+        static NtQueryKeyFunction ntQueryKey = (NtQueryKeyFunction)GetProcAddress(
+                GetModuleHandle(L"ntdll.dll"), "NtQueryKey");
+        if (ntQueryKey == NULL) {
+            return std::wstring();
+        }
+        ULONG size = NAME_BUFFER;
+        std::vector<BYTE> buffer;
+        NTSTATUS status;
+        do {
+            buffer.resize(size);
+            status = ntQueryKey(key, KEY_NAME_INFORMATION_CLASS, buffer.data(), size, &size);
+        }
+        while (status == STATUS_BUFFER_TOO_SMALL || status == STATUS_BUFFER_OVERFLOW);
+        if (status < 0) {
+            return std::wstring();
+        }
+        /* KEY_NAME_INFORMATION: the length of the name in bytes, then the name */
+        ULONG nameLength;
+        memcpy(&nameLength, buffer.data(), sizeof(nameLength));
+        return std::wstring((const WCHAR*)(buffer.data() + sizeof(ULONG)), nameLength / sizeof(WCHAR));
+    }
+};
+
+/**
+ * @class   RemoteBackend
+ *
+ * @brief   The registry of another machine, connected with RegConnectRegistry.
+ *
+ * Only HKEY_LOCAL_MACHINE and HKEY_USERS can be connected remotely. Every
+ * call is a network round trip, so the traversal keeps a window of keys
+ * opened ahead. As a stand-in, the backend serves the local registry the
+ * same way, for trying the window without a network together with the
+ * latency injected by a FaultBackend.
+ *
+ * @date    2026.10.16.
+ */
+
+class RemoteBackend : public Win32Backend {
+    /** @brief  The name of the machine */
+    std::wstring machine;
+    /** @brief  HKEY_LOCAL_MACHINE of the machine */
+    HKEY machineRoot;
+    /** @brief  HKEY_USERS of the machine */
+    HKEY usersRoot;
+    /** @brief  The result of the connection */
+    LSTATUS connectError;
+    /** @brief  True if the local registry stands in for the machine */
+    bool standIn;
+protected:
+    LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        if (parent == HKEY_LOCAL_MACHINE) {
+            parent = machineRoot;
+        }
+        else if (parent == HKEY_USERS) {
+            parent = usersRoot;
+        }
+        else if (parent == HKEY_CURRENT_USER || parent == HKEY_CLASSES_ROOT ||
+                 parent == HKEY_CURRENT_CONFIG) {
+            return ERROR_INVALID_HANDLE;
+        }
+        return Win32Backend::doOpenKey(parent, name, options, sam, result);
+    }
+
+    /* The kernel names of the remote keys are not visible from here */
+    std::wstring doPhysicalName(HKEY)
+    {
+        return std::wstring();
+    }
+public:
+
+    /**
+     * @fn  RemoteBackend(const std::wstring& machine, bool standIn)
+     *
+     * @brief   Connects to the registry of a machine
+     *
+     * @date    2026.10.16.
+     *
+     * @param   machine The name of the machine.
+     * @param   standIn True to serve the local registry instead of connecting.
+     */
+
+    RemoteBackend(const std::wstring& machine, bool standIn) : machine(machine)
+    {
+        this->standIn = standIn;
+        machineRoot = usersRoot = NULL;
+        if (standIn) {
+            machineRoot = HKEY_LOCAL_MACHINE;
+            usersRoot = HKEY_USERS;
+            connectError = ERROR_SUCCESS;
+            return;
+        }
+        connectError = RegConnectRegistry(machine.c_str(), HKEY_LOCAL_MACHINE, &machineRoot);
+        if (connectError == ERROR_SUCCESS) {
+            connectError = RegConnectRegistry(machine.c_str(), HKEY_USERS, &usersRoot);
+        }
+    }
+
+    ~RemoteBackend()
+    {
+        if (!standIn && machineRoot != NULL) {
+            RegCloseKey(machineRoot);
+        }
+        if (!standIn && usersRoot != NULL) {
+            RegCloseKey(usersRoot);
+        }
+    }
+
+    bool hasHive(HKEY hive)
+    {
+        return hive == HKEY_LOCAL_MACHINE || hive == HKEY_USERS;
+    }
+
+    int defaultPrefetch()
+    {
+        return REMOTE_WINDOW;
+    }
+
+    LSTATUS getConnectError()
+    {
+        return connectError;
+    }
+
+    const std::wstring& getMachine()
+    {
+        return machine;
+    }
+};
+#endif
+
+/**
+ * @fn  uint64_t predefinedId(HKEY key)
+ *
+ * @brief   Identifies a predefined handle the same way on every platform
+ *
+ * @date    2026.10.16.
+ *
+ * @param   key The handle.
+ *
+ * @return  The low 32 bits of a predefined handle, 0 for any other handle.
+ */
+
+uint64_t predefinedId(HKEY key)
+{
+    if (key == HKEY_CLASSES_ROOT || key == HKEY_CURRENT_USER || key == HKEY_LOCAL_MACHINE ||
+        key == HKEY_USERS || key == HKEY_CURRENT_CONFIG) {
+        return (uint32_t)(uintptr_t)key;
+    }
+    return 0;
+}
+
+/**
+ * @fn  bool isStringType(DWORD type)
+ *
+ * @brief   Query whether the data of a value consists of wide characters
+ *
+ * @date    2026.10.16.
+ *
+ * @param   type    The type of the value.
+ *
+ * @return  True for the string types.
+ */
+
+bool isStringType(DWORD type)
+{
+    return type == REG_SZ || type == REG_EXPAND_SZ || type == REG_MULTI_SZ || type == REG_LINK;
+}
+
+/**
+ * @enum    TraceOperation
+ *
+ * @brief   The registry calls stored in a trace.
+ */
+
+enum TraceOperation {
+    TRACE_OPEN = 1,
+    TRACE_CLOSE,
+    TRACE_QUERY_INFO,
+    TRACE_ENUM_KEY,
+    TRACE_ENUM_VALUE,
+    TRACE_GET_VALUE,
+    TRACE_SET_VALUE,
+    TRACE_PHYSICAL_NAME
+};
+
+/** @brief  The Windows functions behind the operations, for the statistics */
+static const char* const callNames[] = { "", "RegOpenKeyEx", "RegCloseKey", "RegQueryInfoKey",
+                                         "RegEnumKeyEx", "RegEnumValue", "RegGetValue",
+                                         "RegSetValueEx", "NtQueryKey"
+                                       };
+
+/**
+ * @class   RecordingBackend
+ *
+ * @brief   Records every call made to another backend into a trace file.
+ *
+ * Every record holds the operation, the duration of the call in
+ * nanoseconds, the arguments and the results, as LEB128 numbers, UTF-16
+ * strings and raw data. Handles are replaced by key ids: the same parent,
+ * name and access always get the same id, predefined handles keep their
+ * value.
+ *
+ * @date    2026.10.16.
+ */
+
+class RecordingBackend : public RegistryBackend {
+    /** @brief  The backend whose calls are recorded */
+    std::unique_ptr<RegistryBackend> inner;
+    /** @brief  The trace file */
+    std::ofstream file;
+    /** @brief  Records not yet written to the file */
+    std::string buffer;
+    /** @brief  Guards the buffer and the ids, calls come from several threads */
+    std::mutex mutex;
+    /** @brief  The key id of every open handle */
+    std::unordered_map<HKEY, uint64_t> handles;
+    /** @brief  The key id of every parent, name and access opened so far */
+    std::map<std::pair<uint64_t, std::wstring>, uint64_t> keys;
+    /** @brief  Number of records written */
+    unsigned long long records;
+
+    void writeVarint(uint64_t number)
+    {
+        while (number >= 0x80) {
+            buffer.push_back((char)(number | 0x80));
+            number >>= 7;
+        }
+        buffer.push_back((char)number);
+    }
+
+    void writeString(const TCHAR* string, size_t length)
+    {
+        writeVarint(length);
+        for (size_t i = 0; i < length; i++) {
+            buffer.push_back((char)(string[i] & 0xff));
+            buffer.push_back((char)((string[i] >> 8) & 0xff));
+        }
+    }
+
+    /* String data is written as UTF-16, whatever the size of the local wide characters */
+    void writeData(DWORD type, const void* data, size_t size)
+    {
+        if (sizeof(WCHAR) == 2 || !isStringType(type)) {
+            writeVarint(size);
+            buffer.append((const char*)data, size);
+            return;
+        }
+        const WCHAR* string = (const WCHAR*)data;
+        writeVarint(size / sizeof(WCHAR) * 2);
+        for (size_t i = 0; i < size / sizeof(WCHAR); i++) {
+            buffer.push_back((char)(string[i] & 0xff));
+            buffer.push_back((char)((string[i] >> 8) & 0xff));
+        }
+    }
+
+    size_t traceSize(DWORD type, size_t size)
+    {
+        return isStringType(type) ? size / sizeof(WCHAR) * 2 : size;
+    }
+
+    uint64_t idOf(HKEY key)
+    {
+        uint64_t id = predefinedId(key);
+        if (id == 0) {
+            std::unordered_map<HKEY, uint64_t>::iterator found = handles.find(key);
+            id = (found != handles.end()) ? found->second : 0;
+        }
+        return id;
+    }
+
+    /* Starts a record, the mutex has to be held until it is finished */
+    void beginRecord(TraceOperation operation, std::chrono::steady_clock::time_point start)
+    {
+        records++;
+        buffer.push_back((char)operation);
+        writeVarint(std::chrono::duration_cast<std::chrono::nanoseconds>
+                    (std::chrono::steady_clock::now() - start).count());
+    }
+
+    /* Writes the finished records once enough of them have accumulated */
+    void endRecord()
+    {
+        if (buffer.size() >= TRACE_BUFFER) {
+            file.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+protected:
+    LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LSTATUS status = inner->openKey(parent, name, options, sam, result);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_OPEN, start);
+        uint64_t parentId = idOf(parent), id = 0;
+        writeVarint(parentId);
+        writeVarint(options);
+        writeVarint(sam);
+        writeString(name, _tcslen(name));
+        writeVarint((uint32_t)status);
+        if (status == ERROR_SUCCESS) {
+            std::wstring access = std::to_wstring(options) + L":" + std::to_wstring(sam) + L":" + name;
+            std::map<std::pair<uint64_t, std::wstring>, uint64_t>::iterator found =
+                keys.find(std::make_pair(parentId, access));
+            id = (found != keys.end()) ? found->second : keys.size() + 1;
+            keys[std::make_pair(parentId, access)] = id;
+            handles[*result] = id;
+        }
+        writeVarint(id);
+        endRecord();
+        return status;
+    }
+
+    LSTATUS doCloseKey(HKEY key)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LSTATUS status = inner->closeKey(key);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_CLOSE, start);
+        writeVarint(idOf(key));
+        writeVarint((uint32_t)status);
+        handles.erase(key);
+        endRecord();
+        return status;
+    }
+
+    LSTATUS doQueryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey, LPDWORD values,
+                           LPDWORD longestValueName, LPDWORD longestValueData,
+                           PFILETIME lastWriteTime)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        DWORD numbers[5] = { 0, 0, 0, 0, 0 };
+        FILETIME time = { 0, 0 };
+        LSTATUS status = inner->queryInfoKey(key, &numbers[0], &numbers[1], &numbers[2],
+                                             &numbers[3], &numbers[4], &time);
+        LPDWORD results[5] = { subkeys, longestSubkey, values, longestValueName, longestValueData };
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_QUERY_INFO, start);
+        writeVarint(idOf(key));
+        writeVarint((uint32_t)status);
+        for (int i = 0; i < 5; i++) {
+            writeVarint(numbers[i]);
+            if (results[i] != NULL) {
+                *results[i] = numbers[i];
+            }
+        }
+        writeVarint((uint64_t)time.dwHighDateTime << 32 | time.dwLowDateTime);
+        if (lastWriteTime != NULL) {
+            *lastWriteTime = time;
+        }
+        endRecord();
+        return status;
+    }
+
+    LSTATUS doEnumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LSTATUS status = inner->enumKey(key, index, name, nameLength);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_ENUM_KEY, start);
+        writeVarint(idOf(key));
+        writeVarint(index);
+        writeVarint((uint32_t)status);
+        writeString(name, (status == ERROR_SUCCESS) ? *nameLength : 0);
+        endRecord();
+        return status;
+    }
+
+    LSTATUS doEnumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength, LPDWORD type,
+                        LPBYTE data, LPDWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LSTATUS status = inner->enumValue(key, index, name, nameLength, type, data, dataSize);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_ENUM_VALUE, start);
+        writeVarint(idOf(key));
+        writeVarint(index);
+        writeVarint(data != NULL);
+        writeVarint((uint32_t)status);
+        writeString(name, (status == ERROR_SUCCESS) ? *nameLength : 0);
+        DWORD recordedType = (status == ERROR_SUCCESS && type != NULL) ? *type : 0;
+        writeVarint(recordedType);
+        writeVarint((dataSize != NULL && (status == ERROR_SUCCESS || status == ERROR_MORE_DATA)) ?
+                    traceSize(recordedType, *dataSize) : 0);
+        writeData(recordedType, data, (data != NULL && status == ERROR_SUCCESS) ? *dataSize : 0);
+        endRecord();
+        return status;
+    }
+
+    LSTATUS doGetValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                       LPDWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LSTATUS status = inner->getValue(key, name, flags, type, data, dataSize);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_GET_VALUE, start);
+        writeVarint(idOf(key));
+        writeString(name, _tcslen(name));
+        writeVarint(flags);
+        writeVarint((uint32_t)status);
+        DWORD recordedType = (status == ERROR_SUCCESS && type != NULL) ? *type : 0;
+        writeVarint(recordedType);
+        writeVarint((dataSize != NULL && (status == ERROR_SUCCESS || status == ERROR_MORE_DATA)) ?
+                    traceSize(recordedType, *dataSize) : 0);
+        writeData(recordedType, data, (data != NULL && status == ERROR_SUCCESS) ? *dataSize : 0);
+        endRecord();
+        return status;
+    }
+
+    LSTATUS doSetValue(HKEY key, LPCTSTR name, DWORD type, const BYTE* data, DWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        LSTATUS status = inner->setValue(key, name, type, data, dataSize);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_SET_VALUE, start);
+        writeVarint(idOf(key));
+        writeString(name, _tcslen(name));
+        writeVarint(type);
+        writeData(type, data, dataSize);
+        writeVarint((uint32_t)status);
+        endRecord();
+        return status;
+    }
+
+    std::wstring doPhysicalName(HKEY key)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::wstring name = inner->physicalName(key);
+        std::lock_guard<std::mutex> lock(mutex);
+        beginRecord(TRACE_PHYSICAL_NAME, start);
+        writeVarint(idOf(key));
+        writeString(name.c_str(), name.length());
+        endRecord();
+        return name;
+    }
+public:
+
+    RecordingBackend(std::unique_ptr<RegistryBackend> inner) : inner(std::move(inner))
+    {
+        records = 0;
+    }
+
+    ~RecordingBackend()
+    {
+        file.write(buffer.data(), buffer.size());
+    }
+
+    /**
+     * @fn  bool open(const std::wstring& fileName)
+     *
+     * @brief   Creates the trace file and writes its header
+     *
+     * @date    2026.10.16.
+     *
+     * @param   fileName    The trace file.
+     *
+     * @return  True if it succeeds, false if the file could not be created.
+     */
+
+    bool open(const std::wstring& fileName)
+    {
+        file.open(std::filesystem::path(fileName), std::ios::binary | std::ios::trunc);
+        writeVarint(TRACE_MAGIC);
+        writeVarint(TRACE_VERSION);
+        return (bool)file;
+    }
+
+    bool probesByDefault()
+    {
+        return inner->probesByDefault();
+    }
+
+    bool hasHive(HKEY hive)
+    {
+        return inner->hasHive(hive);
+    }
+
+    int defaultPrefetch()
+    {
+        return inner->defaultPrefetch();
+    }
+
+    void printStatistics()
+    {
+        inner->printStatistics();
+        std::wcout << "Trace records written: " << records << "\n";
+    }
+};
+
+/**
+ * @class   ReplayBackend
+ *
+ * @brief   Answers the registry calls from a recorded trace.
+ *
+ * The answers are looked up by key id and arguments, so the replay does not
+ * have to make the calls in the recorded order, but it has to make the same
+ * calls: options changing the enumeration strategy or the visited keys
+ * lead to calls which were never recorded. These are answered as if the
+ * key or value did not exist and counted as misses. Writes are not applied.
+ *
+ * @date    2026.10.16.
+ */
+
+class ReplayBackend : public RegistryBackend {
+    /**
+     * @struct  Answer
+     *
+     * @brief   The recorded result of a call.
+     */
+
+    struct Answer {
+        /** @brief  The status returned */
+        LSTATUS status;
+        /** @brief  The key id opened, or the metadata of the key */
+        uint64_t numbers[6];
+        /** @brief  The name of the subkey or value, or the physical name */
+        std::wstring name;
+        /** @brief  The type of the value */
+        DWORD type;
+        /** @brief  The size of the value data in bytes */
+        DWORD size;
+        /** @brief  True if the data was recorded */
+        bool hasData;
+        /** @brief  The value data, strings converted to the local wide characters */
+        std::vector<BYTE> data;
+        /** @brief  The duration of the recorded call */
+        std::chrono::nanoseconds duration;
+    };
+
+    /** @brief  Operation, key id, number and name of a call */
+    typedef std::tuple<int, uint64_t, uint64_t, std::wstring> Call;
+
+    /** @brief  The answers of the trace */
+    std::map<Call, Answer> answers;
+    /** @brief  Sleep for the recorded duration of every call */
+    bool timing;
+    /** @brief  True if the recording enumerated without querying the keys first */
+    bool probed;
+    /** @brief  Number of calls without a recorded answer */
+    std::atomic<unsigned long long> misses;
+    /** @brief  Sum of the recorded durations of the calls answered, in nanoseconds */
+    std::atomic<unsigned long long> recordedTime;
+
+    static bool readVarint(std::istream& stream, uint64_t& number)
+    {
+        number = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = stream.get();
+            if (byte == EOF) {
+                return false;
+            }
+            number |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool readString(std::istream& stream, std::wstring& string)
+    {
+        uint64_t length;
+        if (!readVarint(stream, length) || length > MAX_VALUE_NAME + 1) {
+            return false;
+        }
+        string.clear();
+        for (uint64_t i = 0; i < length; i++) {
+            unsigned char bytes[2];
+            if (!stream.read((char*)bytes, sizeof(bytes))) {
+                return false;
+            }
+            string.push_back((wchar_t)(bytes[0] | (bytes[1] << 8)));
+        }
+        return true;
+    }
+
+    /* String data is recorded as UTF-16, the sizes follow the local wide characters */
+    static bool readData(std::istream& stream, DWORD type, std::vector<BYTE>& data)
+    {
+        uint64_t size;
+        if (!readVarint(stream, size) || size > TRACE_MAX_DATA) {
+            return false;
+        }
+        data.resize((size_t)size);
+        if (size > 0 && !stream.read((char*)data.data(), (std::streamsize)size)) {
+            return false;
+        }
+        if (sizeof(WCHAR) != 2 && isStringType(type)) {
+            std::vector<BYTE> converted(data.size() / 2 * sizeof(WCHAR));
+            for (size_t i = 0; i + 1 < data.size(); i += 2) {
+                WCHAR character = (WCHAR)(data[i] | (data[i + 1] << 8));
+                memcpy(converted.data() + i / 2 * sizeof(WCHAR), &character, sizeof(WCHAR));
+            }
+            data.swap(converted);
+        }
+        return true;
+    }
+
+    static uint64_t idOf(HKEY key)
+    {
+        uint64_t id = predefinedId(key);
+        return (id != 0) ? id : (uint64_t)(uintptr_t)key;
+    }
+
+    /* Keeps the most complete answer of a call recorded more than once */
+    void store(const Call& call, const Answer& answer)
+    {
+        std::map<Call, Answer>::iterator found = answers.find(call);
+        if (found == answers.end() || (answer.hasData && !found->second.hasData) ||
+            (found->second.status == ERROR_MORE_DATA && answer.status == ERROR_SUCCESS)) {
+            answers[call] = answer;
+        }
+    }
+
+    /* Looks up the answer of a call and waits as long as the recorded call took */
+    const Answer* find(const Call& call)
+    {
+        std::map<Call, Answer>::const_iterator found = answers.find(call);
+        if (found == answers.end()) {
+            misses++;
+            return NULL;
+        }
+        recordedTime += found->second.duration.count();
+        if (timing) {
+            std::this_thread::sleep_for(found->second.duration);
+        }
+        return &found->second;
+    }
+
+    /* Copies value data the way the registry does, or reports the size needed */
+    static LSTATUS copyData(const Answer& answer, LPDWORD type, void* data, LPDWORD dataSize)
+    {
+        if (answer.status != ERROR_SUCCESS && answer.status != ERROR_MORE_DATA) {
+            return answer.status;
+        }
+        if (type != NULL) {
+            *type = answer.type;
+        }
+        if (dataSize == NULL) {
+            return answer.status == ERROR_MORE_DATA ? ERROR_SUCCESS : answer.status;
+        }
+        DWORD available = *dataSize;
+        *dataSize = answer.hasData ? (DWORD)answer.data.size() : answer.size;
+        if (data == NULL) {
+            return ERROR_SUCCESS;
+        }
+        if (!answer.hasData || available < answer.data.size()) {
+            return answer.hasData ? ERROR_MORE_DATA : ERROR_NOT_SUPPORTED;
+        }
+        memcpy(data, answer.data.data(), answer.data.size());
+        return ERROR_SUCCESS;
+    }
+protected:
+    LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        const Answer* answer = find(Call(TRACE_OPEN, idOf(parent), (uint64_t)options << 32 | sam,
+                                         name));
+        if (answer == NULL) {
+            return ERROR_FILE_NOT_FOUND;
+        }
+        if (answer->status == ERROR_SUCCESS) {
+            *result = (HKEY)(uintptr_t)answer->numbers[0];
+        }
+        return answer->status;
+    }
+
+    LSTATUS doCloseKey(HKEY)
+    {
+        return ERROR_SUCCESS;
+    }
+
+    LSTATUS doQueryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey, LPDWORD values,
+                           LPDWORD longestValueName, LPDWORD longestValueData,
+                           PFILETIME lastWriteTime)
+    {
+        const Answer* answer = find(Call(TRACE_QUERY_INFO, idOf(key), 0, std::wstring()));
+        if (answer == NULL) {
+            return ERROR_FILE_NOT_FOUND;
+        }
+        LPDWORD results[5] = { subkeys, longestSubkey, values, longestValueName, longestValueData };
+        for (int i = 0; i < 5; i++) {
+            if (results[i] != NULL) {
+                *results[i] = (DWORD)answer->numbers[i];
+            }
+        }
+        /* The longest value data is in bytes, strings take more of them here */
+        if (longestValueData != NULL) {
+            *longestValueData = (*longestValueData + 1) / 2 * sizeof(WCHAR);
+        }
+        if (lastWriteTime != NULL) {
+            lastWriteTime->dwLowDateTime = (DWORD)answer->numbers[5];
+            lastWriteTime->dwHighDateTime = (DWORD)(answer->numbers[5] >> 32);
+        }
+        return answer->status;
+    }
+
+    LSTATUS doEnumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength)
+    {
+        const Answer* answer = find(Call(TRACE_ENUM_KEY, idOf(key), index, std::wstring()));
+        if (answer == NULL) {
+            return ERROR_NO_MORE_ITEMS;
+        }
+        if (answer->status != ERROR_SUCCESS) {
+            return answer->status;
+        }
+        if (answer->name.length() + 1 > *nameLength) {
+            return ERROR_MORE_DATA;
+        }
+        _tcscpy_s(name, *nameLength, answer->name.c_str());
+        *nameLength = (DWORD)answer->name.length();
+        return ERROR_SUCCESS;
+    }
+
+    LSTATUS doEnumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength, LPDWORD type,
+                        LPBYTE data, LPDWORD dataSize)
+    {
+        const Answer* answer = find(Call(TRACE_ENUM_VALUE, idOf(key), index, std::wstring()));
+        if (answer == NULL) {
+            return ERROR_NO_MORE_ITEMS;
+        }
+        if (answer->status != ERROR_SUCCESS && answer->status != ERROR_MORE_DATA) {
+            return answer->status;
+        }
+        if (answer->name.length() + 1 > *nameLength) {
+            return ERROR_MORE_DATA;
+        }
+        _tcscpy_s(name, *nameLength, answer->name.c_str());
+        *nameLength = (DWORD)answer->name.length();
+        return copyData(*answer, type, data, dataSize);
+    }
+
+    LSTATUS doGetValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                       LPDWORD dataSize)
+    {
+        const Answer* answer = find(Call(TRACE_GET_VALUE, idOf(key), flags, name));
+        if (answer == NULL) {
+            return ERROR_FILE_NOT_FOUND;
+        }
+        return copyData(*answer, type, data, dataSize);
+    }
+
+    LSTATUS doSetValue(HKEY key, LPCTSTR name, DWORD, const BYTE*, DWORD)
+    {
+        const Answer* answer = find(Call(TRACE_SET_VALUE, idOf(key), 0, name));
+        return (answer != NULL) ? answer->status : ERROR_SUCCESS;
+    }
+
+    std::wstring doPhysicalName(HKEY key)
+    {
+        const Answer* answer = find(Call(TRACE_PHYSICAL_NAME, idOf(key), 0, std::wstring()));
+        return (answer != NULL) ? answer->name : std::wstring();
+    }
+public:
+
+    ReplayBackend(bool timing)
+    {
+        this->timing = timing;
+        probed = true;
+        misses = 0;
+        recordedTime = 0;
+    }
+
+    /**
+     * @fn  bool load(const std::wstring& fileName)
+     *
+     * @brief   Reads the answers from a trace file
+     *
+     * @date    2026.10.16.
+     *
+     * @param   fileName    The trace file.
+     *
+     * @return  True if it succeeds, false if the file is missing or malformed.
+     */
+
+    bool load(const std::wstring& fileName)
+    {
+        std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+        uint64_t magic, version;
+        if (!file || !readVarint(file, magic) || magic != TRACE_MAGIC ||
+            !readVarint(file, version) || version != TRACE_VERSION) {
+            return false;
+        }
+        bool queried = false, dataEnumerated = false;
+        int operation;
+        while ((operation = file.get()) != EOF) {
+            Answer answer = { ERROR_SUCCESS, { 0, 0, 0, 0, 0, 0 }, std::wstring(), 0, 0, false,
+                              std::vector<BYTE>(), std::chrono::nanoseconds(0) };
+            uint64_t duration, id, number = 0, options, status, withData = 1, type = 0, size = 0;
+            std::wstring name;
+            std::vector<BYTE> written;
+            bool valid = readVarint(file, duration) && readVarint(file, id);
+            switch (operation) {
+            case TRACE_OPEN:
+                /* The options and the access requested identify the call */
+                valid = valid && readVarint(file, options) && readVarint(file, number) &&
+                        readString(file, name) && readVarint(file, status) &&
+                        readVarint(file, answer.numbers[0]);
+                number |= options << 32;
+                break;
+            case TRACE_CLOSE:
+                valid = valid && readVarint(file, status);
+                break;
+            case TRACE_QUERY_INFO:
+                queried = true;
+                valid = valid && readVarint(file, status);
+                for (int i = 0; i < 6; i++) {
+                    valid = valid && readVarint(file, answer.numbers[i]);
+                }
+                break;
+            case TRACE_ENUM_KEY:
+                valid = valid && readVarint(file, number) && readVarint(file, status) &&
+                        readString(file, answer.name);
+                break;
+            case TRACE_ENUM_VALUE:
+                valid = valid && readVarint(file, number) && readVarint(file, withData) &&
+                        readVarint(file, status) && readString(file, answer.name) &&
+                        readVarint(file, type) && readVarint(file, size) &&
+                        readData(file, (DWORD)type, answer.data);
+                dataEnumerated = dataEnumerated || withData != 0;
+                break;
+            case TRACE_GET_VALUE:
+                valid = valid && readString(file, name) && readVarint(file, number) &&
+                        readVarint(file, status) && readVarint(file, type) &&
+                        readVarint(file, size) && readData(file, (DWORD)type, answer.data);
+                break;
+            case TRACE_SET_VALUE:
+                valid = valid && readString(file, name) && readVarint(file, type) &&
+                        readData(file, (DWORD)type, written) && readVarint(file, status);
+                type = 0;
+                break;
+            case TRACE_PHYSICAL_NAME:
+                status = ERROR_SUCCESS;
+                valid = valid && readString(file, answer.name);
+                break;
+            default:
+                valid = false;
+            }
+            if (!valid) {
+                return false;
+            }
+            if (operation == TRACE_CLOSE) {
+                continue;
+            }
+            answer.status = (LSTATUS)(uint32_t)status;
+            answer.type = (DWORD)type;
+            answer.hasData = (withData != 0 && answer.status == ERROR_SUCCESS);
+            /* Without the data only the size is known, assume it is a string */
+            answer.size = (DWORD)(answer.hasData ? answer.data.size() : (size + 1) / 2 * sizeof(WCHAR));
+            answer.duration = std::chrono::nanoseconds(duration);
+            store(Call(operation, id, number, name), answer);
+        }
+        probed = dataEnumerated || !queried;
+        return true;
+    }
+
+    bool probesByDefault()
+    {
+        return probed;
+    }
+
+    /* Only the hives opened successfully during the recording */
+    bool hasHive(HKEY hive)
+    {
+        uint64_t id = predefinedId(hive);
+        for (std::map<Call, Answer>::const_iterator found =
+                 answers.lower_bound(Call(TRACE_OPEN, id, 0, std::wstring()));
+             found != answers.end() && std::get<0>(found->first) == TRACE_OPEN &&
+             std::get<1>(found->first) == id; found++) {
+            if (found->second.status == ERROR_SUCCESS) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void printStatistics()
+    {
+        std::wcout << "Replayed calls without a recorded answer: " << misses << "\n";
+        std::wcout << "Recorded duration of the replayed calls: " << recordedTime / 1000000 <<
+                   " ms\n";
+    }
+};
+
+/**
+ * @enum    FaultKind
+ *
+ * @brief   The effects a FaultBackend can have on a call.
+ */
+
+enum FaultKind {
+    /** @brief  Fixed delay in milliseconds */
+    FAULT_DELAY,
+    /** @brief  Exponentially distributed delay with the given mean in milliseconds */
+    FAULT_EXPONENTIAL,
+    /** @brief  Log-normally distributed delay with the given median in milliseconds and sigma */
+    FAULT_LOGNORMAL,
+    /** @brief  ERROR_ACCESS_DENIED at the given rate, for the given number of calls in a row */
+    FAULT_DENIED,
+    /** @brief  ERROR_MORE_DATA at the given rate, as if the value grew since its size was read */
+    FAULT_MORE_DATA,
+    /** @brief  The key is deleted at the given rate, as if the hive changed during the scan */
+    FAULT_CHANGED
+};
+
+/**
+ * @struct  Fault
+ *
+ * @brief   One effect on a call, with its parameters.
+ */
+
+struct Fault {
+    FaultKind kind;
+    double first;
+    double second;
+};
+
+/**
+ * @struct  FaultProfile
+ *
+ * @brief   The effects on each kind of call, indexed by TraceOperation.
+ */
+
+struct FaultProfile {
+    std::vector<Fault> faults[TRACE_PHYSICAL_NAME + 1];
+};
+
+/**
+ * @fn  bool parseFaultProfile(const std::wstring& spec, FaultProfile& profile)
+ *
+ * @brief   Reads a fault profile from its description
+ *
+ * The description is a comma separated list of call=effect:parameters,
+ * e.g. open=lognormal:1:1.5,enumkey=denied:0.01:50,*=delay:2. The calls
+ * are open, close, info, enumkey, enumvalue, getvalue, setvalue and name,
+ * * stands for all of them. The effects are delay:ms, exp:mean,
+ * lognormal:median:sigma, denied:rate[:calls], moredata:rate and
+ * changed:rate.
+ *
+ * @date    2026.10.16.
+ *
+ * @param           spec    The description of the profile.
+ * @param [out]     profile The profile read.
+ *
+ * @return  True if it succeeds, false if the description is malformed.
+ */
+
+bool parseFaultProfile(const std::wstring& spec, FaultProfile& profile)
+{
+    static const wchar_t* calls[] = { L"*", L"open", L"close", L"info", L"enumkey", L"enumvalue",
+                                      L"getvalue", L"setvalue", L"name"
+                                    };
+    static const wchar_t* kinds[] = { L"delay", L"exp", L"lognormal", L"denied", L"moredata",
+                                      L"changed"
+                                    };
+    size_t start = 0;
+    while (start < spec.length()) {
+        size_t end = spec.find(L',', start);
+        std::wstring item = spec.substr(start, end == std::wstring::npos ? std::wstring::npos :
+                                        end - start);
+        start = (end == std::wstring::npos) ? spec.length() : end + 1;
+        size_t equals = item.find(L'=');
+        if (equals == std::wstring::npos) {
+            return false;
+        }
+        std::vector<std::wstring> parts;
+        std::wistringstream stream(item.substr(equals + 1));
+        for (std::wstring part; std::getline(stream, part, L':');) {
+            parts.push_back(part);
+        }
+        if (parts.empty()) {
+            return false;
+        }
+        int call = -1, kind = -1;
+        for (int i = 0; i <= TRACE_PHYSICAL_NAME; i++) {
+            call = (item.compare(0, equals, calls[i]) == 0) ? i : call;
+        }
+        for (int i = 0; i <= FAULT_CHANGED; i++) {
+            kind = (parts[0] == kinds[i]) ? i : kind;
+        }
+        if (call < 0 || kind < 0 || parts.size() < 2 || parts.size() > 3) {
+            return false;
+        }
+        Fault fault = { (FaultKind)kind, 0, 1 };
+        wchar_t* rest;
+        fault.first = wcstod(parts[1].c_str(), &rest);
+        bool valid = (*rest == 0 && fault.first >= 0);
+        if (parts.size() == 3) {
+            fault.second = wcstod(parts[2].c_str(), &rest);
+            valid = valid && *rest == 0 && (kind == FAULT_LOGNORMAL || kind == FAULT_DENIED);
+        }
+        else {
+            valid = valid && kind != FAULT_LOGNORMAL;
+        }
+        if (!valid || (kind >= FAULT_DENIED && fault.first > 1)) {
+            return false;
+        }
+        for (int i = (call == 0) ? TRACE_OPEN : call; i <= ((call == 0) ? TRACE_PHYSICAL_NAME : call); i++) {
+            profile.faults[i].push_back(fault);
+        }
+    }
+    return true;
+}
+
+/**
+ * @class   FaultBackend
+ *
+ * @brief   Makes the calls of another backend slower and less reliable.
+ *
+ * The delays and errors of a FaultProfile are applied to every call, which
+ * shows how the traversal copes with slow keys, bursts of denied access,
+ * values growing while they are read and keys deleted during the scan.
+ * The duration of every call as seen by the traversal is sampled into a
+ * reservoir, from which the tail latencies are estimated.
+ *
+ * @date    2026.10.16.
+ */
+
+class FaultBackend : public RegistryBackend {
+    /** @brief  The backend the calls are passed on to */
+    std::unique_ptr<RegistryBackend> inner;
+    /** @brief  The effects on each kind of call */
+    FaultProfile profile;
+    /** @brief  Guards the random numbers and the statistics */
+    std::mutex mutex;
+    /** @brief  Decides about the effects */
+    std::mt19937 random;
+    /** @brief  Number of calls still to be denied in the current burst, per kind of call */
+    unsigned int bursts[TRACE_PHYSICAL_NAME + 1];
+    /** @brief  Number of errors injected */
+    unsigned long long injected;
+    /** @brief  Number of call durations offered to the reservoir */
+    unsigned long long measured;
+    /** @brief  Uniform sample of the call durations in nanoseconds */
+    std::vector<uint64_t> latencies;
+    /** @brief  The longest call in nanoseconds */
+    uint64_t maxLatency;
+
+    /* Delays the call and decides whether it fails, ERROR_SUCCESS lets it through */
+    LSTATUS inject(TraceOperation operation, bool& moreData)
+    {
+        std::chrono::duration<double, std::milli> delay(0);
+        LSTATUS error = ERROR_SUCCESS;
+        moreData = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Fault& fault : profile.faults[operation]) {
+                switch (fault.kind) {
+                case FAULT_DELAY:
+                    delay += std::chrono::duration<double, std::milli>(fault.first);
+                    break;
+                case FAULT_EXPONENTIAL:
+                    delay += std::chrono::duration<double, std::milli>
+                             (std::exponential_distribution<double>(1 / std::max(fault.first, 1e-9))(random));
+                    break;
+                case FAULT_LOGNORMAL:
+                    delay += std::chrono::duration<double, std::milli>
+                             (std::lognormal_distribution<double>(std::log(std::max(fault.first, 1e-9)),
+                                                                  fault.second)(random));
+                    break;
+                case FAULT_DENIED:
+                    if (bursts[operation] == 0 && std::bernoulli_distribution(fault.first)(random)) {
+                        bursts[operation] = std::max((unsigned int)fault.second, 1u);
+                    }
+                    if (bursts[operation] > 0) {
+                        bursts[operation]--;
+                        error = ERROR_ACCESS_DENIED;
+                    }
+                    break;
+                case FAULT_MORE_DATA:
+                    moreData = moreData || std::bernoulli_distribution(fault.first)(random);
+                    break;
+                case FAULT_CHANGED:
+                    if (std::bernoulli_distribution(fault.first)(random)) {
+                        error = (operation == TRACE_OPEN) ? ERROR_FILE_NOT_FOUND : ERROR_KEY_DELETED;
+                    }
+                    break;
+                }
+            }
+            if (error != ERROR_SUCCESS || moreData) {
+                injected++;
+            }
+        }
+        if (delay.count() >= SPIN_DELAY_MS) {
+            std::this_thread::sleep_for(delay);
+        }
+        else if (delay.count() > 0) {
+            /* Sleeping is too coarse for short delays, the timer ticks every 15.6 ms on Windows */
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+            while (std::chrono::steady_clock::now() < end) {
+                std::this_thread::yield();
+            }
+        }
+        return error;
+    }
+
+    /* Reports that the value grew, the caller has to retry with a larger buffer */
+    static LSTATUS growValue(LSTATUS status, bool moreData, const void* data, LPDWORD dataSize)
+    {
+        if (status != ERROR_SUCCESS || !moreData || data == NULL || dataSize == NULL) {
+            return status;
+        }
+        *dataSize += sizeof(WCHAR);
+        return ERROR_MORE_DATA;
+    }
+
+    void measure(std::chrono::steady_clock::time_point start)
+    {
+        uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>
+                           (std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        maxLatency = std::max(maxLatency, latency);
+        if (latencies.size() < LATENCY_SAMPLES) {
+            latencies.push_back(latency);
+        }
+        else {
+            uint64_t slot = std::uniform_int_distribution<uint64_t>(0, measured)(random);
+            if (slot < LATENCY_SAMPLES) {
+                latencies[(size_t)slot] = latency;
+            }
+        }
+        measured++;
+    }
+protected:
+    LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        LSTATUS status = inject(TRACE_OPEN, moreData);
+        if (status == ERROR_SUCCESS) {
+            status = inner->openKey(parent, name, options, sam, result);
+        }
+        measure(start);
+        return status;
+    }
+
+    /* A handle is always closed, or it would leak */
+    LSTATUS doCloseKey(HKEY key)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        inject(TRACE_CLOSE, moreData);
+        LSTATUS status = inner->closeKey(key);
+        measure(start);
+        return status;
+    }
+
+    LSTATUS doQueryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey, LPDWORD values,
+                           LPDWORD longestValueName, LPDWORD longestValueData,
+                           PFILETIME lastWriteTime)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        LSTATUS status = inject(TRACE_QUERY_INFO, moreData);
+        if (status == ERROR_SUCCESS) {
+            status = inner->queryInfoKey(key, subkeys, longestSubkey, values, longestValueName,
+                                         longestValueData, lastWriteTime);
+        }
+        measure(start);
+        return status;
+    }
+
+    LSTATUS doEnumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        LSTATUS status = inject(TRACE_ENUM_KEY, moreData);
+        if (status == ERROR_SUCCESS) {
+            status = inner->enumKey(key, index, name, nameLength);
+        }
+        measure(start);
+        return status;
+    }
+
+    LSTATUS doEnumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength, LPDWORD type,
+                        LPBYTE data, LPDWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        LSTATUS status = inject(TRACE_ENUM_VALUE, moreData);
+        if (status == ERROR_SUCCESS) {
+            status = growValue(inner->enumValue(key, index, name, nameLength, type, data, dataSize),
+                               moreData, data, dataSize);
+        }
+        measure(start);
+        return status;
+    }
+
+    LSTATUS doGetValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                       LPDWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        LSTATUS status = inject(TRACE_GET_VALUE, moreData);
+        if (status == ERROR_SUCCESS) {
+            status = growValue(inner->getValue(key, name, flags, type, data, dataSize), moreData,
+                               data, dataSize);
+        }
+        measure(start);
+        return status;
+    }
+
+    LSTATUS doSetValue(HKEY key, LPCTSTR name, DWORD type, const BYTE* data, DWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        LSTATUS status = inject(TRACE_SET_VALUE, moreData);
+        if (status == ERROR_SUCCESS) {
+            status = inner->setValue(key, name, type, data, dataSize);
+        }
+        measure(start);
+        return status;
+    }
+
+    std::wstring doPhysicalName(HKEY key)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool moreData;
+        std::wstring name;
+        if (inject(TRACE_PHYSICAL_NAME, moreData) == ERROR_SUCCESS) {
+            name = inner->physicalName(key);
+        }
+        measure(start);
+        return name;
+    }
+public:
+
+    /**
+     * @fn  FaultBackend(std::unique_ptr<RegistryBackend> inner, const FaultProfile& profile,
+     *                   unsigned int seed)
+     *
+     * @brief   Wraps a backend
+     *
+     * @date    2026.10.16.
+     *
+     * @param   inner   The backend the calls are passed on to.
+     * @param   profile The effects on each kind of call.
+     * @param   seed    Seed of the effects, 0 picks a random seed.
+     */
+
+    FaultBackend(std::unique_ptr<RegistryBackend> inner, const FaultProfile& profile,
+                 unsigned int seed) : inner(std::move(inner)), profile(profile),
+        random(seed != 0 ? seed : std::random_device()())
+    {
+        std::fill(bursts, bursts + TRACE_PHYSICAL_NAME + 1, 0);
+        injected = measured = maxLatency = 0;
+    }
+
+    bool probesByDefault()
+    {
+        return inner->probesByDefault();
+    }
+
+    bool hasHive(HKEY hive)
+    {
+        return inner->hasHive(hive);
+    }
+
+    int defaultPrefetch()
+    {
+        return inner->defaultPrefetch();
+    }
+
+    unsigned long long getInjected()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return injected;
+    }
+
+    /**
+     * @fn  double latencyPercentile(double percentile)
+     *
+     * @brief   Estimates a percentile of the call durations
+     *
+     * @date    2026.10.16.
+     *
+     * @param   percentile  The percentile, between 0 and 100.
+     *
+     * @return  The duration in microseconds.
+     */
+
+    double latencyPercentile(double percentile)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (latencies.empty()) {
+            return 0;
+        }
+        std::vector<uint64_t> sorted(latencies);
+        size_t rank = std::min((size_t)(percentile / 100 * sorted.size()), sorted.size() - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank] / 1000.0;
+    }
+
+    double getMaxLatency()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return maxLatency / 1000.0;
+    }
+
+    void printStatistics()
+    {
+        inner->printStatistics();
+        std::wcout << "Injected faults: " << getInjected() << "\n";
+        std::wcout << "Call latency: p50 " << latencyPercentile(50) << " us, p99 " <<
+                   latencyPercentile(99) << " us, p99.9 " << latencyPercentile(99.9) <<
+                   " us, max " << getMaxLatency() << " us\n";
+    }
+};
+
+/**
+ * @class   LatencyHistogram
+ *
+ * @brief   Distribution of durations in the manner of an HDR histogram.
+ *
+ * Every power of two is split into HISTOGRAM_SUB_BUCKETS buckets, so a
+ * duration is known to within about 3% over the whole range while the
+ * histogram keeps a fixed size and a recording is just an increment.
+ *
+ * @date    2026.10.16.
+ */
+
+class LatencyHistogram {
+    /** @brief  Number of durations in each bucket */
+    std::vector<uint64_t> counts;
+    /** @brief  Number of durations recorded */
+    uint64_t total;
+    /** @brief  Sum of the durations in nanoseconds */
+    uint64_t sum;
+    /** @brief  The longest duration in nanoseconds */
+    uint64_t longest;
+
+    static int bucket(uint64_t value)
+    {
+        if (value < HISTOGRAM_SUB_BUCKETS) {
+            return (int)value;
+        }
+        int exponent = 0;
+        for (int shift = 32; shift > 0; shift /= 2) {
+            if ((value >> (exponent + shift)) != 0) {
+                exponent += shift;
+            }
+        }
+        int bits = exponent - HISTOGRAM_SUB_BITS;
+        return ((bits + 1) << HISTOGRAM_SUB_BITS) + (int)((value >> bits) & (HISTOGRAM_SUB_BUCKETS - 1));
+    }
+
+    /* The largest duration falling into a bucket */
+    static uint64_t highest(int bucket)
+    {
+        if (bucket < HISTOGRAM_SUB_BUCKETS) {
+            return bucket;
+        }
+        int bits = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+        return ((uint64_t)(HISTOGRAM_SUB_BUCKETS + (bucket & (HISTOGRAM_SUB_BUCKETS - 1)) + 1) << bits) - 1;
+    }
+public:
+    LatencyHistogram() : counts((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+    {
+        total = sum = longest = 0;
+    }
+
+    /**
+     * @fn  void record(uint64_t nanoseconds)
+     *
+     * @brief   Adds a duration, durations beyond the range count as the largest one
+     *
+     * @date    2026.10.16.
+     *
+     * @param   nanoseconds The duration.
+     */
+
+    void record(uint64_t nanoseconds)
+    {
+        nanoseconds = std::min(nanoseconds, ((uint64_t)1 << HISTOGRAM_MAX_BITS) - 1);
+        counts[bucket(nanoseconds)]++;
+        total++;
+        sum += nanoseconds;
+        longest = std::max(longest, nanoseconds);
+    }
+
+    void add(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < counts.size(); i++) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        longest = std::max(longest, other.longest);
+    }
+
+    /**
+     * @fn  uint64_t percentile(double percentile) const
+     *
+     * @brief   Finds the duration below which the given share of the durations fall
+     *
+     * @date    2026.10.16.
+     *
+     * @param   percentile  The percentile, between 0 and 100.
+     *
+     * @return  The duration in nanoseconds, 0 if none was recorded.
+     */
+
+    uint64_t percentile(double percentile) const
+    {
+        uint64_t rank = (uint64_t)std::ceil(percentile / 100 * total), seen = 0;
+        for (size_t i = 0; i < counts.size() && total > 0; i++) {
+            seen += counts[i];
+            if (seen >= std::max(rank, (uint64_t)1)) {
+                return std::min(highest((int)i), longest);
+            }
+        }
+        return longest;
+    }
+
+    uint64_t getCount() const
+    {
+        return total;
+    }
+
+    uint64_t getSum() const
+    {
+        return sum;
+    }
+
+    uint64_t getMax() const
+    {
+        return longest;
+    }
+
+    /**
+     * @fn  void writeJson(std::ostream& stream) const
+     *
+     * @brief   Writes the non-empty buckets as [highest duration, count] pairs
+     *
+     * @date    2026.10.16.
+     *
+     * @param [in,out]  stream  The stream written to.
+     */
+
+    void writeJson(std::ostream& stream) const
+    {
+        stream << "[";
+        const char* separator = "";
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (counts[i] != 0) {
+                stream << separator << "[" << highest((int)i) << "," << counts[i] << "]";
+                separator = ",";
+            }
+        }
+        stream << "]";
+    }
+};
+
+/**
+ * @struct  CallStatistics
+ *
+ * @brief   Counts and durations of the registry calls of one thread, indexed by TraceOperation.
+ */
+
+struct CallStatistics {
+    /** @brief  Number of calls which failed, the end of an enumeration and a short buffer do not count */
+    uint64_t errors[TRACE_PHYSICAL_NAME + 1] = {};
+    /** @brief  Number of failed calls by error code */
+    std::map<LSTATUS, uint64_t> errorCodes[TRACE_PHYSICAL_NAME + 1];
+    /** @brief  Durations of the calls */
+    LatencyHistogram latencies[TRACE_PHYSICAL_NAME + 1];
+};
+
+/**
+ * @class   InstrumentedBackend
+ *
+ * @brief   Counts and times the calls made to another backend.
+ *
+ * Every thread records into its own CallStatistics, so the calls of the
+ * prefetching threads never contend. Each buffer has a lock of its own
+ * which only the metrics exporter takes from another thread, so the
+ * buffers can also be merged during the traversal.
+ *
+ * @date    2026.10.16.
+ */
+
+class InstrumentedBackend : public RegistryBackend {
+    /** @brief  The backend the calls are passed on to */
+    std::unique_ptr<RegistryBackend> inner;
+    /** @brief  File the statistics are written to, empty for none */
+    std::wstring fileName;
+    /** @brief  Tells the instances apart for the buffers of the threads */
+    uint64_t instance;
+    /** @brief  Guards the list of buffers */
+    std::mutex mutex;
+    /** @brief  The statistics of one thread and their lock */
+    struct Buffer {
+        std::mutex mutex;
+        CallStatistics statistics;
+    };
+
+    /** @brief  The buffers of the threads which made calls */
+    std::vector<std::unique_ptr<Buffer>> buffers;
+
+    Buffer& local()
+    {
+        thread_local uint64_t owner = 0;
+        thread_local Buffer* buffer = NULL;
+        if (owner != instance) {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.push_back(std::unique_ptr<Buffer>(new Buffer()));
+            buffer = buffers.back().get();
+            owner = instance;
+        }
+        return *buffer;
+    }
+
+    LSTATUS measure(TraceOperation operation, std::chrono::steady_clock::time_point start,
+                    LSTATUS status)
+    {
+        uint64_t duration = std::chrono::duration_cast<std::chrono::nanoseconds>
+                            (std::chrono::steady_clock::now() - start).count();
+        Buffer& buffer = local();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.statistics.latencies[operation].record(duration);
+        if (status != ERROR_SUCCESS && status != ERROR_MORE_DATA && status != ERROR_NO_MORE_ITEMS) {
+            buffer.statistics.errors[operation]++;
+            buffer.statistics.errorCodes[operation][status]++;
+        }
+        return status;
+    }
+protected:
+    LSTATUS doOpenKey(HKEY parent, LPCTSTR name, DWORD options, REGSAM sam, PHKEY result)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_OPEN, start, inner->openKey(parent, name, options, sam, result));
+    }
+
+    LSTATUS doCloseKey(HKEY key)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_CLOSE, start, inner->closeKey(key));
+    }
+
+    LSTATUS doQueryInfoKey(HKEY key, LPDWORD subkeys, LPDWORD longestSubkey, LPDWORD values,
+                           LPDWORD longestValueName, LPDWORD longestValueData,
+                           PFILETIME lastWriteTime)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_QUERY_INFO, start, inner->queryInfoKey(key, subkeys, longestSubkey,
+                       values, longestValueName, longestValueData, lastWriteTime));
+    }
+
+    LSTATUS doEnumKey(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_ENUM_KEY, start, inner->enumKey(key, index, name, nameLength));
+    }
+
+    LSTATUS doEnumValue(HKEY key, DWORD index, LPTSTR name, LPDWORD nameLength, LPDWORD type,
+                        LPBYTE data, LPDWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_ENUM_VALUE, start, inner->enumValue(key, index, name, nameLength, type,
+                       data, dataSize));
+    }
+
+    LSTATUS doGetValue(HKEY key, LPCTSTR name, DWORD flags, LPDWORD type, PVOID data,
+                       LPDWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_GET_VALUE, start, inner->getValue(key, name, flags, type, data,
+                       dataSize));
+    }
+
+    LSTATUS doSetValue(HKEY key, LPCTSTR name, DWORD type, const BYTE* data, DWORD dataSize)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return measure(TRACE_SET_VALUE, start, inner->setValue(key, name, type, data, dataSize));
+    }
+
+    std::wstring doPhysicalName(HKEY key)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::wstring name = inner->physicalName(key);
+        measure(TRACE_PHYSICAL_NAME, start, ERROR_SUCCESS);
+        return name;
+    }
+public:
+
+    /**
+     * @fn  InstrumentedBackend(std::unique_ptr<RegistryBackend> inner, const std::wstring& fileName)
+     *
+     * @brief   Wraps a backend
+     *
+     * @date    2026.10.16.
+     *
+     * @param   inner       The backend the calls are passed on to.
+     * @param   fileName    File the statistics are written to as JSON, empty for none.
+     */
+
+    InstrumentedBackend(std::unique_ptr<RegistryBackend> inner, const std::wstring& fileName) :
+        inner(std::move(inner)), fileName(fileName)
+    {
+        static std::atomic<uint64_t> instances(0);
+        instance = ++instances;
+    }
+
+    bool probesByDefault()
+    {
+        return inner->probesByDefault();
+    }
+
+    bool hasHive(HKEY hive)
+    {
+        return inner->hasHive(hive);
+    }
+
+    int defaultPrefetch()
+    {
+        return inner->defaultPrefetch();
+    }
+
+    /**
+     * @fn  CallStatistics merge()
+     *
+     * @brief   Adds up the buffers of the threads
+     *
+     * @date    2026.10.16.
+     *
+     * @return  The statistics of all calls.
+     */
+
+    CallStatistics merge()
+    {
+        CallStatistics merged;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::unique_ptr<Buffer>& buffer : buffers) {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            for (int i = TRACE_OPEN; i <= TRACE_PHYSICAL_NAME; i++) {
+                merged.errors[i] += buffer->statistics.errors[i];
+                merged.latencies[i].add(buffer->statistics.latencies[i]);
+                for (const std::pair<const LSTATUS, uint64_t>& code : buffer->statistics.errorCodes[i]) {
+                    merged.errorCodes[i][code.first] += code.second;
+                }
+            }
+        }
+        return merged;
+    }
+
+    bool getCallStatistics(CallStatistics& statistics)
+    {
+        statistics = merge();
+        return true;
+    }
+
+    /**
+     * @fn  bool writeStatistics(const CallStatistics& statistics)
+     *
+     * @brief   Writes the statistics to the file as JSON
+     *
+     * @date    2026.10.16.
+     *
+     * @param   statistics  The merged statistics.
+     *
+     * @return  True if it succeeds, false if the file could not be written.
+     */
+
+    bool writeStatistics(const CallStatistics& statistics)
+    {
+        std::ofstream file(std::filesystem::path(fileName), std::ios::trunc);
+        file << "{\"calls\":[";
+        const char* separator = "";
+        for (int i = TRACE_OPEN; i <= TRACE_PHYSICAL_NAME; i++) {
+            const LatencyHistogram& latencies = statistics.latencies[i];
+            file << separator << "{\"call\":\"" << callNames[i] << "\",\"count\":" <<
+                 latencies.getCount() << ",\"errors\":" << statistics.errors[i] <<
+                 ",\"total_ns\":" << latencies.getSum() << ",\"p50_ns\":" <<
+                 latencies.percentile(50) << ",\"p90_ns\":" << latencies.percentile(90) <<
+                 ",\"p99_ns\":" << latencies.percentile(99) << ",\"p999_ns\":" <<
+                 latencies.percentile(99.9) << ",\"max_ns\":" << latencies.getMax() <<
+                 ",\"histogram_ns\":";
+            latencies.writeJson(file);
+            file << "}";
+            separator = ",";
+        }
+        file << "]}\n";
+        file.close();
+        return !file.fail();
+    }
+
+    void printStatistics()
+    {
+        CallStatistics statistics = merge();
+        std::streamsize precision = std::wcout.precision();
+        std::wcout << "Call                count    errors  total ms    p50 us    p99 us  p99.9 us    max us\n";
+        for (int i = TRACE_OPEN; i <= TRACE_PHYSICAL_NAME; i++) {
+            const LatencyHistogram& latencies = statistics.latencies[i];
+            if (latencies.getCount() == 0) {
+                continue;
+            }
+            std::wcout << std::left << std::setw(16) << callNames[i] << std::right << std::fixed <<
+                       std::setw(9) << latencies.getCount() << std::setw(10) << statistics.errors[i] <<
+                       std::setprecision(1) << std::setw(10) << latencies.getSum() / 1e6 <<
+                       std::setw(10) << latencies.percentile(50) / 1e3 << std::setw(10) <<
+                       latencies.percentile(99) / 1e3 << std::setw(10) <<
+                       latencies.percentile(99.9) / 1e3 << std::setw(10) << latencies.getMax() / 1e3 <<
+                       std::defaultfloat << std::setprecision(precision) << "\n";
+        }
+        if (!fileName.empty() && !writeStatistics(statistics)) {
+            std::wcout << "Error: unable to write the call statistics to " << fileName << "\n";
+        }
+        inner->printStatistics();
+    }
+};
+
+/**
+ * @class   RegKey
+ *
+ * @brief   Representation of a key in the registry.
+ *
+ * @date    2018.03.16.
+ */
+
+class RegKey {
+    /** @brief  The registry the key belongs to */
+    RegistryBackend* backend;
+    /** @brief  The depth of the current key. Used to detect stack overflow. */
+    int depth;
+    /** @brief  The error code of the registry API */
+    DWORD errorCode;
+    /** @brief  Evaulates whether the key was successfully opened */
+    bool isValidb;
+    /** @brief  Handle of the key */
+    HKEY key;
+    /** @brief  Evaluates whether the handle is currently open */
+    bool isOpenb;
+    /** @brief  The name of the key */
+    TCHAR name[NAME_BUFFER];
+    /** @brief  Number of subkeys of the key */
+    DWORD subkeyCount;
+    /** @brief  Size of the longest subkey */
+    DWORD longestSubkeySize;
+    /** @brief  Size of the longest subclass */
+    DWORD longestSubClassSize;
+    /** @brief  Number of values */
+    DWORD valueCount;
+    /** @brief  Length of the name of the longest value */
+    DWORD longestValueName;
+    /** @brief  Information describing the longest value */
+    DWORD longestValueData;
+    /** @brief  Size of the security descriptor */
+    DWORD securityDescriptorSize;
+    /** @brief  The last write time */
+    FILETIME lastWriteTime;
+    /** @brief  The registry view the key was opened in */
+    REGSAM view;
+    /** @brief  The full path of the key, starting with the hive */
+    std::wstring path;
+    /** @brief  Handle of the hive the key is in */
+    HKEY root;
+    /** @brief  The path of the key relative to the hive */
+    std::wstring relativePath;
+    /** @brief  Evaluates whether the metadata of the key was retrieved */
+    bool hasInfo;
+public:
+
+    /**
+     * @fn  RegKey(RegistryBackend& backend, HKEY parent, const TCHAR* name, int depth,
+     *              REGSAM view = KEY_WOW64_64KEY, DWORD options = REG_OPTION_OPEN_LINK)
+     *
+     * @brief   Creates a new registry key under the parent key
+     *
+     * By default a symbolic link is opened as the link itself, so the
+     * traversal does not follow it into another part of the registry.
+     * When the backend is probing, the metadata is only retrieved once it
+     * is asked for. The key is opened for reading only, see openForWrite().
+     *
+     * @date    2018.03.16.
+     *
+     * @param [in,out]  backend The registry the key belongs to.
+     * @param           parent  Handle of the parent.
+     * @param           name    The name.
+     * @param           depth   The depth of the key from the root of the hive
+     * @param           view    KEY_WOW64_64KEY or KEY_WOW64_32KEY
+     * @param           options REG_OPTION_OPEN_LINK, or 0 to follow links
+     */
+
+    RegKey(RegistryBackend& backend, HKEY parent, const TCHAR* name, int depth,
+           REGSAM view = KEY_WOW64_64KEY, DWORD options = REG_OPTION_OPEN_LINK)
+    {
+        this->backend = &backend;
+        this->depth = depth;
+        this->view = view;
+        _tcscpy_s(this->name, NAME_BUFFER, name);
+        path = name;
+        root = parent;
+        relativePath = name;
+        hasInfo = false;
+        subkeyCount = valueCount = longestValueData = 0;
+        errorCode = backend.openKey(parent, name, options, KEY_READ | view, &key);
+        isValidb = (errorCode == ERROR_SUCCESS);
+        isOpenb = isValidb;
+        if (isValidb) {
+            if (!backend.isProbing()) {
+                getInfo();
+            }
+        }
+        else {
+            if (errorCode == ERROR_ACCESS_DENIED) {
+                TRACE << "Access denied. Are you an administrator? " << name << "\n";
+            }
+            else if (errorCode != ERROR_FILE_NOT_FOUND) {
+                TRACE << "Error during key open: " << errorCode << " " << name << "\n";
+            }
+        }
+    }
+
+    /**
+     * @fn  ~RegKey()
+     *
+     * @brief   Closes the key if it was opened successfully in the first place
+     *
+     * @date    2018.03.16.
+     */
+
+    ~RegKey()
+    {
+        if (isOpenb) {
+            backend->closeKey(key);
+        }
+    }
+
+    /**
+     * @fn  void close()
+     *
+     * @brief   Releases the handle while keeping the information of the key
+     *
+     * @date    2026.10.16.
+     */
+
+    void close()
+    {
+        if (isOpenb) {
+            backend->closeKey(key);
+            isOpenb = false;
+        }
+    }
+
+    /**
+     * @fn  bool reopen()
+     *
+     * @brief   Opens the key again by its path relative to the hive after close()
+     *
+     * @date    2026.10.16.
+     *
+     * @return  True if it succeeds, false if the key is gone or inaccessible.
+     */
+
+    bool reopen()
+    {
+        errorCode = backend->openKey(root, relativePath.c_str(), REG_OPTION_OPEN_LINK,
+                                     KEY_READ | view, &key);
+        isOpenb = (errorCode == ERROR_SUCCESS);
+        return isOpenb;
+    }
+
+    bool isOpen()
+    {
+        return isOpenb;
+    }
+
+    /**
+     * @fn  LSTATUS openForWrite(PHKEY writeKey)
+     *
+     * @brief   Opens a second handle to the key which allows setting values
+     *
+     * Only keys with matches need write access, so the access check for it
+     * is done once per such key instead of once per key traversed.
+     *
+     * @date    2026.10.16.
+     *
+     * @param [out]     writeKey    The handle opened, to be closed by the caller.
+     *
+     * @return  ERROR_SUCCESS, or the error code of the open.
+     */
+
+    LSTATUS openForWrite(PHKEY writeKey)
+    {
+        return backend->openKey(key, L"", 0, KEY_SET_VALUE | view, writeKey);
+    }
+
+    /**
+     * @fn  void getInfo()
+     *
+     * @brief   Retrieves metadata of the key (used for subkey count mainly)
+     *
+     * @date    2018.03.16.
+     */
+
+    void getInfo()
+    {
+        hasInfo = true;
+        backend->queryInfoKey(key, &subkeyCount, &longestSubkeySize, &valueCount,
+                              &longestValueName, &longestValueData, &lastWriteTime);
+    }
+
+    TCHAR* getName()
+    {
+        return name;
+    }
+
+    HKEY getKey()
+    {
+        return key;
+    }
+
+    RegistryBackend& getBackend()
+    {
+        return *backend;
+    }
+
+    DWORD getSubkeyCount()
+    {
+        if (!hasInfo && isOpenb) {
+            getInfo();
+        }
+        return subkeyCount;
+    }
+
+    DWORD getValueCount()
+    {
+        if (!hasInfo && isOpenb) {
+            getInfo();
+        }
+        return valueCount;
+    }
+
+    DWORD getLongestValueData()
+    {
+        if (!hasInfo && isOpenb) {
+            getInfo();
+        }
+        return longestValueData;
+    }
+
+    /**
+     * @fn  bool isValid()
+     *
+     * @brief   Query whether the key was successfully opened
+     *
+     * @date    2018.03.16.
+     *
+     * @return  True if valid, false if not.
+     */
+
+    bool isValid()
+    {
+        return isValidb;
+    }
+
+    /**
+     * @fn  int getDepth()
+     *
+     * @brief   Retrieves the current distance from the root of the hive
+     *
+     * @date    2018.03.16.
+     *
+     * @return  The depth from the root of the hive
+     */
+
+    int getDepth()
+    {
+        return depth;
+    }
+
+    DWORD getErrorCode()
+    {
+        return errorCode;
+    }
+
+    REGSAM getView()
+    {
+        return view;
+    }
+
+    const std::wstring& getPath()
+    {
+        return path;
+    }
+
+    /**
+     * @fn  void setParent(RegKey *parent)
+     *
+     * @brief   Derives the full and the relative path of a subkey from its parent
+     *
+     * @date    2026.10.16.
+     *
+     * @param [in,out]  parent  The key the subkey was opened under.
+     */
+
+    void setParent(RegKey *parent)
+    {
+        path = parent->path + L"\\" + name;
+        root = parent->root;
+        relativePath = parent->relativePath.empty() ? std::wstring(name) :
+                       parent->relativePath + L"\\" + name;
+    }
+
+    /**
+     * @fn  void setHive(const std::wstring& hiveName)
+     *
+     * @brief   Marks the key as the root of a hive
+     *
+     * @date    2026.10.16.
+     *
+     * @param   hiveName    The name of the hive, used as the start of the paths.
+     */
+
+    void setHive(const std::wstring& hiveName)
+    {
+        path = hiveName;
+    }
+
+
+    /**
+     * @fn  std::wstring getPhysicalName()
+     *
+     * @brief   Retrieves the name of the key in the kernel object namespace
+     *
+     * @date    2026.10.16.
+     *
+     * @return  The physical name, or an empty string if it is not available.
+     */
+
+    std::wstring getPhysicalName()
+    {
+        if (!isOpenb) {
+            return std::wstring();
+        }
+        return backend->physicalName(key);
+    }
+};
+
+/**
+ * @fn  std::wstring Replace(const std::wstring& haystack, const std::wstring& needle,
+ *                           const std::wstring& replacement)
+ *
+ * @brief   Replaces all occurences of the needle in the haystack.
+ *
+ * Does not modify the original string.
+ *
+ * @date    2018.03.16.
+ *
+ * @param   haystack    The whole original string.
+ * @param   needle      The string to be replaced.
+ * @param   replacement The replacement.
+ *
+ * @return  A std::wstring containing the replaced string.
+ */
+
+std::wstring Replace(const std::wstring& haystack, const std::wstring& needle,
+                     const std::wstring& replacement)
+{
+    std::wstring value = haystack;
+    size_t pos = 0;
+
+    while (true) {
+        pos = value.find(needle, pos);
+        if (pos == std::wstring::npos)
+            break;
+
+        value.replace(pos, needle.length(), replacement);
+        pos += replacement.length();
+    }
+
+    return value;
+}
+
+/**
+ * @struct  Hive
+ *
+ * @brief   A root key of the registry.
+ *
+ * @date    2026.10.16.
+ */
+
+struct Hive {
+    /** @brief  Predefined handle of the root key */
+    HKEY key;
+    /** @brief  The name of the root key */
+    const TCHAR* name;
+    /** @brief  The abbreviated name of the root key */
+    const TCHAR* shortName;
+};
+
+/** @brief  The hives in the order they are traversed, most profile paths first */
+static const Hive hives[] = {
+    { HKEY_CURRENT_USER, L"HKEY_CURRENT_USER", L"HKCU" },
+    { HKEY_USERS, L"HKEY_USERS", L"HKU" },
+    { HKEY_LOCAL_MACHINE, L"HKEY_LOCAL_MACHINE", L"HKLM" },
+    { HKEY_CURRENT_CONFIG, L"HKEY_CURRENT_CONFIG", L"HKCC" },
+    { HKEY_CLASSES_ROOT, L"HKEY_CLASSES_ROOT", L"HKCR" },
+};
+
+/** @brief  Number of hives */
+static const size_t hiveCount = sizeof(hives) / sizeof(hives[0]);
+
+/**
+ * @fn  const Hive* findHive(const std::wstring& name)
+ *
+ * @brief   Looks up a hive by its full or abbreviated name
+ *
+ * @date    2026.10.16.
+ *
+ * @param   name    The name of the hive, case insensitive.
+ *
+ * @return  The hive, or null if there is no such hive.
+ */
+
+const Hive* findHive(const std::wstring& name)
+{
+    for (const Hive& hive : hives) {
+        if (_tcsicmp(name.c_str(), hive.name) == 0 || _tcsicmp(name.c_str(), hive.shortName) == 0) {
+            return &hive;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @struct  Options
+ *
+ * @brief   Settings given on the command line.
+ *
+ * @date    2026.10.16.
+ */
+
+struct Options {
+    /** @brief  Continue from the last checkpoint instead of starting over */
+    bool resume = false;
+    /** @brief  File the traversal position is periodically saved to */
+    std::wstring checkpointFile = CHECKPOINT_FILE;
+    /** @brief  Seconds between two checkpoints, 0 disables checkpointing */
+    int checkpointInterval = CHECKPOINT_INTERVAL;
+    /** @brief  Run with background CPU and I/O priority */
+    bool background = false;
+    /** @brief  Maximum number of keys opened per second, 0 means unlimited */
+    double keysPerSecond = 0;
+    /** @brief  Maximum share of one core used by the traversal, 0 means unlimited */
+    int cpuPercent = 0;
+    /** @brief  Seconds after which the traversal stops, 0 means no deadline */
+    int deadline = 0;
+    /** @brief  Number of random paths sampled per hive, 0 runs a full traversal */
+    int samples = 0;
+    /** @brief  Seed of the sampling, 0 picks a random seed */
+    unsigned int seed = 0;
+    /** @brief  Process the known locations before anything else */
+    bool fast = false;
+    /** @brief  File listing the known locations, empty for the one next to the executable */
+    std::wstring locationsFile;
+    /** @brief  Traverse the whole registry after the known locations */
+    bool full = false;
+    /** @brief  Leave the traversal of the whole registry to a background process */
+    bool deferFull = false;
+    /** @brief  The command line arguments, passed on to the background process */
+    std::vector<std::wstring> arguments;
+    /** @brief  Globs of the subtrees to traverse, empty for all */
+    std::vector<std::wstring> includes;
+    /** @brief  Globs of the subtrees to skip */
+    std::vector<std::wstring> excludes;
+    /** @brief  Traverse every hive, even the ones which are views of other hives */
+    bool noDedup = false;
+    /** @brief  Also cover the 32-bit view of the selected keys */
+    bool wow64 = false;
+    /** @brief  Maximum number of key handles kept open, 0 means unlimited */
+    unsigned long maxHandles = 0;
+    /** @brief  Enumeration strategy, "info" or "probe", empty for the default of the backend */
+    std::wstring enumeration;
+    /** @brief  Number of siblings opened ahead on helper threads, negative for the default */
+    int prefetch = -1;
+    /** @brief  Machines scanned remotely instead of the local registry */
+    std::vector<std::wstring> targets;
+    /** @brief  Number of machines scanned at the same time */
+    int concurrentTargets = CONCURRENT_TARGETS;
+    /** @brief  Serve the targets from the local registry with this latency in ms, 0 connects */
+    int simulatedLatency = 0;
+    /** @brief  Delays and errors injected into the registry calls, see parseFaultProfile */
+    std::wstring faults;
+    /** @brief  Measure the traversal under each fault profile instead of scanning */
+    bool benchmark = false;
+    /** @brief  Count the matches without replacing them */
+    bool readOnly = false;
+    /** @brief  File the statistics of the registry calls are written to, empty for none */
+    std::wstring callStatsFile;
+    /** @brief  The most detailed messages written */
+    LogLevel logLevel = LOG_INFO;
+    /** @brief  File the messages are written to, empty for the console */
+    std::wstring logFile;
+    /** @brief  File one JSON line per match is written to, empty for no report */
+    std::wstring reportFile;
+    /** @brief  File the phases of the scan are written to as Chrome trace events, empty for none */
+    std::wstring timelineFile;
+    /** @brief  File the time per key path is written to as folded stacks, empty for none */
+    std::wstring foldedFile;
+    /** @brief  File the registry calls per key path are written to as folded stacks, empty for none */
+    std::wstring foldedCallsFile;
+    /** @brief  Number of the slowest key opens, enumerations and value reads printed, 0 for none */
+    int top = 0;
+    /** @brief  Print a progress line on the standard error during the scan */
+    bool progress = false;
+    /** @brief  Prometheus text file the metrics of the scan are periodically written to, empty for none */
+    std::wstring metricsFile;
+    /** @brief  Seconds between two writes of the metrics file */
+    int metricsInterval = METRICS_INTERVAL;
+    /** @brief  The remote machine scanned with these settings, empty for the local registry */
+    std::wstring target;
+    /** @brief  File every registry call is recorded to, empty for no recording */
+    std::wstring recordFile;
+    /** @brief  Trace the registry calls are answered from instead of the registry */
+    std::wstring replayFile;
+    /** @brief  Take as long as the recorded calls took when replaying */
+    bool replayTiming = false;
+};
+
+/**
+ * @fn  std::chrono::nanoseconds threadCpuTime()
+ *
+ * @brief   Retrieves the CPU time consumed by the calling thread
+ *
+ * @date    2026.10.16.
+ *
+ * @return  The sum of the kernel and user time of the thread.
+ */
+
+std::chrono::nanoseconds threadCpuTime()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return std::chrono::nanoseconds(0);
+    }
+    ULONGLONG ticks = ((ULONGLONG)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+                      ((ULONGLONG)user.dwHighDateTime << 32 | user.dwLowDateTime);
+    /* FILETIME counts in 100 nanosecond units */
+    return std::chrono::nanoseconds(ticks * 100);
+#else
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#endif
+}
+
+/**
+ * @class   Throttle
+ *
+ * @brief   Paces the traversal to stay within a key rate and a CPU budget.
+ *
+ * The key rate is enforced with a token bucket holding a tenth of a second
+ * worth of keys, so bursts stay short. The CPU budget is checked every few
+ * keys against the thread CPU time, and the traversal sleeps until the
+ * consumed time falls back under the allowed share of the wall time.
+ *
+ * @date    2026.10.16.
+ */
+
+class Throttle {
+    /** @brief  Tokens added per second */
+    double rate;
+    /** @brief  Maximum number of tokens */
+    double capacity;
+    /** @brief  Tokens currently available */
+    double tokens;
+    /** @brief  Time of the last refill */
+    std::chrono::steady_clock::time_point lastRefill;
+    /** @brief  Allowed share of one core, 0 if unlimited */
+    int cpuPercent;
+    /** @brief  Keys paced since the last CPU measurement */
+    int keysSinceSample;
+    /** @brief  Wall time when CPU accounting started */
+    std::chrono::steady_clock::time_point wallStart;
+    /** @brief  Thread CPU time when CPU accounting started */
+    std::chrono::nanoseconds cpuStart;
+public:
+
+    /**
+     * @fn  Throttle(double keysPerSecond, int cpuPercent)
+     *
+     * @brief   Creates a throttle, zero values disable the respective limit
+     *
+     * @date    2026.10.16.
+     *
+     * @param   keysPerSecond   Maximum number of keys per second.
+     * @param   cpuPercent      Maximum share of one core in percent.
+     */
+
+    Throttle(double keysPerSecond, int cpuPercent)
+    {
+        rate = keysPerSecond;
+        capacity = std::max(1.0, rate / 10);
+        tokens = capacity;
+        lastRefill = std::chrono::steady_clock::now();
+        this->cpuPercent = cpuPercent;
+        keysSinceSample = 0;
+        wallStart = lastRefill;
+        cpuStart = threadCpuTime();
+    }
+
+    /**
+     * @fn  void pace()
+     *
+     * @brief   Blocks until the next key may be processed
+     *
+     * @date    2026.10.16.
+     */
+
+    void pace()
+    {
+        if (rate > 0) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            tokens = std::min(capacity, tokens +
+                              std::chrono::duration<double>(now - lastRefill).count() * rate);
+            lastRefill = now;
+            if (tokens < 1) {
+                std::this_thread::sleep_for(std::chrono::duration<double>((1 - tokens) / rate));
+                tokens = 1;
+                lastRefill = std::chrono::steady_clock::now();
+            }
+            tokens -= 1;
+        }
+        if (cpuPercent > 0 && ++keysSinceSample >= CPU_SAMPLE_KEYS) {
+            keysSinceSample = 0;
+            std::chrono::nanoseconds used = threadCpuTime() - cpuStart;
+            std::chrono::nanoseconds allowed = std::chrono::duration_cast<std::chrono::nanoseconds>
+                                               (std::chrono::steady_clock::now() - wallStart) * cpuPercent / 100;
+            if (used > allowed) {
+                std::this_thread::sleep_for((used - allowed) * 100 / cpuPercent);
+            }
+        }
+    }
+};
+
+/**
+ * @fn  bool matchSegment(const TCHAR* pattern, const TCHAR* name)
+ *
+ * @brief   Matches a key name against a glob segment, case insensitively
+ *
+ * "*" matches any number of characters, "?" matches exactly one.
+ *
+ * @date    2026.10.16.
+ *
+ * @param   pattern The glob segment.
+ * @param   name    The name of the key.
+ *
+ * @return  True if the name matches the pattern.
+ */
+
+bool matchSegment(const TCHAR* pattern, const TCHAR* name)
+{
+    const TCHAR* star = NULL;
+    const TCHAR* retry = NULL;
+    while (*name) {
+        if (*pattern == L'*') {
+            star = pattern++;
+            retry = name;
+        }
+        else if (*pattern == L'?' || towupper(*pattern) == towupper(*name)) {
+            pattern++;
+            name++;
+        }
+        else if (star != NULL) {
+            /* Let the last star swallow one more character */
+            pattern = star + 1;
+            name = ++retry;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == L'*') {
+        pattern++;
+    }
+    return *pattern == 0;
+}
+
+/**
+ * @class   PathFilter
+ *
+ * @brief   Decides which subtrees are traversed, based on include and exclude globs.
+ *
+ * The globs are key paths starting with the hive, where "*" and "?" match
+ * within a segment and a "**" segment matches any number of segments.
+ * A key is traversed if an include glob matches it or one of its
+ * ancestors (or there are no include globs at all) and no exclude glob does.
+ * Keys on the way to an include glob are descended into without processing
+ * their values.
+ *
+ * The globs are compiled lazily into a DFA: a state is the set of glob
+ * positions reachable by the path so far, and the traversal advances it
+ * one segment at a time. As soon as a state can no longer lead to an
+ * included key, or an exclude glob matched, the subtree is pruned before
+ * it is opened. Transitions are cached per state and segment name.
+ *
+ * @date    2026.10.16.
+ */
+
+class PathFilter {
+    /** @brief  A compiled glob */
+    struct Pattern {
+        /** @brief  The segments of the glob */
+        std::vector<std::wstring> segments;
+        /** @brief  True for an exclude glob */
+        bool exclude;
+    };
+    /** @brief  A state of the DFA */
+    struct State {
+        /** @brief  Positions (pattern, next segment) still in progress */
+        std::vector<std::pair<int, int>> positions;
+        /** @brief  An include glob matched the key or one of its ancestors */
+        bool included;
+        /** @brief  An exclude glob matched the key or one of its ancestors */
+        bool excluded;
+        /** @brief  Some include glob can still match a descendant */
+        bool live;
+        /** @brief  Cached transitions, keyed by the upper case segment */
+        std::unordered_map<std::wstring, int> next;
+    };
+    /** @brief  The globs */
+    std::vector<Pattern> patterns;
+    /** @brief  True if at least one include glob was given */
+    bool hasIncludes;
+    /** @brief  The states built so far */
+    std::vector<State> states;
+    /** @brief  Index of each state by its positions and flags */
+    std::map<std::vector<int>, int> stateIndex;
+
+    /**
+     * @fn  int intern(std::vector<std::pair<int, int>>& positions, bool included)
+     *
+     * @brief   Closes a set of positions over "**" and looks up or creates its state
+     *
+     * @date    2026.10.16.
+     *
+     * @param [in,out]  positions   The positions reached, closed in place.
+     * @param           included    An include glob matched an ancestor.
+     *
+     * @return  The index of the state.
+     */
+
+    int intern(std::vector<std::pair<int, int>>& positions, bool included)
+    {
+        bool excluded = false;
+        std::vector<std::pair<int, int>> closed;
+        for (size_t i = 0; i < positions.size(); i++) {
+            const Pattern& pattern = patterns[positions[i].first];
+            int segment = positions[i].second;
+            if (segment == (int)pattern.segments.size()) {
+                if (pattern.exclude) {
+                    excluded = true;
+                }
+                else {
+                    included = true;
+                }
+                continue;
+            }
+            if (pattern.segments[segment] == L"**") {
+                /* "**" may also match no segment at all */
+                positions.push_back(std::make_pair(positions[i].first, segment + 1));
+            }
+            closed.push_back(positions[i]);
+        }
+        std::sort(closed.begin(), closed.end());
+        closed.erase(std::unique(closed.begin(), closed.end()), closed.end());
+        bool live = false;
+        std::vector<std::pair<int, int>> kept;
+        for (const std::pair<int, int>& position : closed) {
+            /* Include globs do not matter any more below an included key */
+            if (!patterns[position.first].exclude) {
+                if (included) {
+                    continue;
+                }
+                live = true;
+            }
+            kept.push_back(position);
+        }
+        if (excluded) {
+            kept.clear();
+        }
+        std::vector<int> key;
+        key.push_back(included ? 1 : 0);
+        key.push_back(excluded ? 1 : 0);
+        for (const std::pair<int, int>& position : kept) {
+            key.push_back(position.first);
+            key.push_back(position.second);
+        }
+        std::map<std::vector<int>, int>::iterator found = stateIndex.find(key);
+        if (found != stateIndex.end()) {
+            return found->second;
+        }
+        State state;
+        state.positions = kept;
+        state.included = included || !hasIncludes;
+        state.excluded = excluded;
+        state.live = live;
+        states.push_back(state);
+        stateIndex[key] = (int)states.size() - 1;
+        return (int)states.size() - 1;
+    }
+
+    /**
+     * @fn  void add(const std::wstring& glob, bool exclude)
+     *
+     * @brief   Splits a glob into segments and adds it to the filter
+     *
+     * @date    2026.10.16.
+     *
+     * @param   glob    The glob.
+     * @param   exclude True for an exclude glob.
+     */
+
+    void add(const std::wstring& glob, bool exclude)
+    {
+        Pattern pattern;
+        pattern.exclude = exclude;
+        size_t start = 0;
+        while (start <= glob.length()) {
+            size_t end = glob.find(L'\\', start);
+            if (end == std::wstring::npos) {
+                end = glob.length();
+            }
+            if (end > start) {
+                pattern.segments.push_back(glob.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+        /* The traversal names the hives by their full names */
+        if (!pattern.segments.empty()) {
+            const Hive* hive = findHive(pattern.segments[0]);
+            if (hive != NULL) {
+                pattern.segments[0] = hive->name;
+            }
+        }
+        patterns.push_back(pattern);
+        hasIncludes = hasIncludes || !exclude;
+        states.clear();
+        stateIndex.clear();
+    }
+public:
+
+    PathFilter()
+    {
+        hasIncludes = false;
+    }
+
+    void include(const std::wstring& glob)
+    {
+        add(glob, false);
+    }
+
+    void exclude(const std::wstring& glob)
+    {
+        add(glob, true);
+    }
+
+    /**
+     * @fn  bool isEmpty()
+     *
+     * @brief   Query whether any glob was given
+     *
+     * @date    2026.10.16.
+     *
+     * @return  True if every key is traversed.
+     */
+
+    bool isEmpty()
+    {
+        return patterns.empty();
+    }
+
+    /**
+     * @fn  int start()
+     *
+     * @brief   Retrieves the state before the hive segment
+     *
+     * @date    2026.10.16.
+     *
+     * @return  The initial state.
+     */
+
+    int start()
+    {
+        std::vector<std::pair<int, int>> positions;
+        for (size_t i = 0; i < patterns.size(); i++) {
+            positions.push_back(std::make_pair((int)i, 0));
+        }
+        return intern(positions, false);
+    }
+
+    /**
+     * @fn  int advance(int from, const std::wstring& segment)
+     *
+     * @brief   Moves the DFA to a subkey
+     *
+     * @date    2026.10.16.
+     *
+     * @param   from    The state of the parent key.
+     * @param   segment The name of the subkey.
+     *
+     * @return  The state of the subkey.
+     */
+
+    int advance(int from, const std::wstring& segment)
+    {
+        std::wstring upper = segment;
+        std::transform(upper.begin(), upper.end(), upper.begin(), towupper);
+        std::unordered_map<std::wstring, int>::iterator cached = states[from].next.find(upper);
+        if (cached != states[from].next.end()) {
+            return cached->second;
+        }
+        std::vector<std::pair<int, int>> positions;
+        for (const std::pair<int, int>& position : states[from].positions) {
+            const std::wstring& pattern = patterns[position.first].segments[position.second];
+            if (pattern == L"**") {
+                positions.push_back(position);
+            }
+            else if (matchSegment(pattern.c_str(), segment.c_str())) {
+                positions.push_back(std::make_pair(position.first, position.second + 1));
+            }
+        }
+        int to = intern(positions, states[from].included && hasIncludes);
+        /* Bounds the memory used by huge flat keys such as CLSID */
+        if (states[from].next.size() < FILTER_CACHE_SIZE) {
+            states[from].next[upper] = to;
+        }
+        return to;
+    }
+
+    /**
+     * @fn  bool prunes(int state)
+     *
+     * @brief   Query whether the subtree of a key can be skipped entirely
+     *
+     * @date    2026.10.16.
+     *
+     * @param   state   The state of the key.
+     *
+     * @return  True if neither the key nor its descendants are traversed.
+     */
+
+    bool prunes(int state)
+    {
+        return states[state].excluded || (!states[state].included && !states[state].live);
+    }
+
+    /**
+     * @fn  bool selects(int state)
+     *
+     * @brief   Query whether the values of a key are processed
+     *
+     * @date    2026.10.16.
+     *
+     * @param   state   The state of the key.
+     *
+     * @return  True if the key itself is included.
+     */
+
+    bool selects(int state)
+    {
+        return states[state].included && !states[state].excluded;
+    }
+};
+
+/**
+ * @fn  std::wstring wow64Variant(const std::wstring& glob)
+ *
+ * @brief   Translates a glob to the physical location of its 32-bit view
+ *
+ * The 32-bit view of HKEY_LOCAL_MACHINE\SOFTWARE is stored below
+ * SOFTWARE\WOW6432Node, and that of the classes below Classes\Wow6432Node.
+ * Keys shared between the views have no such counterpart, so they are
+ * still matched only once by the original glob.
+ *
+ * @date    2026.10.16.
+ *
+ * @param   glob    A glob in the 64-bit view.
+ *
+ * @return  The glob of the redirected keys, or an empty string if the glob
+ *          does not reach into a redirected key.
+ */
+
+std::wstring wow64Variant(const std::wstring& glob)
+{
+    std::vector<std::wstring> segments;
+    size_t start = 0;
+    while (start <= glob.length()) {
+        size_t end = glob.find(L'\\', start);
+        if (end == std::wstring::npos) {
+            end = glob.length();
+        }
+        segments.push_back(glob.substr(start, end - start));
+        start = end + 1;
+    }
+    const Hive* hive = findHive(segments[0]);
+    if (hive == NULL) {
+        return std::wstring();
+    }
+    size_t insert = 0;
+    for (size_t i = 1; i + 1 < segments.size() && insert == 0; i++) {
+        if (_tcsicmp(segments[i].c_str(), L"Software") == 0 &&
+            _tcsicmp(segments[i + 1].c_str(), L"Classes") == 0) {
+            insert = i + 2;
+        }
+    }
+    if (insert == 0 && hive->key == HKEY_LOCAL_MACHINE && segments.size() > 1 &&
+        _tcsicmp(segments[1].c_str(), L"SOFTWARE") == 0) {
+        insert = 2;
+    }
+    if (insert == 0 && hive->key == HKEY_CLASSES_ROOT) {
+        insert = 1;
+    }
+    /* Only globs below the redirected key have a separate 32-bit location */
+    if (insert == 0 || insert >= segments.size() ||
+        _tcsicmp(segments[insert].c_str(), L"WOW6432Node") == 0) {
+        return std::wstring();
+    }
+    segments.insert(segments.begin() + insert, L"WOW6432Node");
+    std::wstring variant = segments[0];
+    for (size_t i = 1; i < segments.size(); i++) {
+        variant += L"\\" + segments[i];
+    }
+    return variant;
+}
+
+/**
+ * @struct  ResumePoint
+ *
+ * @brief   Position of the traversal on one level of the key path.
+ *
+ * All subkeys before the index are finished, the one at the index is in
+ * progress. An index equal to the subkey count with an empty name means that
+ * only the values of the key are left.
+ *
+ * @date    2026.10.16.
+ */
+
+struct ResumePoint {
+    /** @brief  Index of the subkey being traversed */
+    DWORD index;
+    /** @brief  Name of the subkey, used to validate the checkpoint */
+    std::wstring name;
+};
+
+/**
+ * @class   Prefetcher
+ *
+ * @brief   Opens subkeys on helper threads ahead of the traversal.
+ *
+ * While a subtree is traversed, the helpers already open the next siblings
+ * of its root, so the latency of a slow registry is hidden behind the work
+ * on the subtree. The opened keys are handed over through futures, in the
+ * order they were requested.
+ *
+ * @date    2026.10.16.
+ */
+
+class Prefetcher {
+    /**
+     * @struct  Job
+     *
+     * @brief   A subkey to be opened.
+     */
+
+    struct Job {
+        /** @brief  The key the subkey is opened under */
+        RegKey* parent;
+        /** @brief  The handle of the parent when the job was queued */
+        HKEY parentKey;
+        /** @brief  The name of the subkey */
+        std::wstring name;
+        /** @brief  Receives the opened key */
+        std::promise<RegKey*> result;
+    };
+
+    /** @brief  The registry the keys are opened in */
+    RegistryBackend& backend;
+    /** @brief  The helper threads */
+    std::vector<std::thread> threads;
+    /** @brief  Guards the jobs and the pending counts */
+    std::mutex mutex;
+    /** @brief  Signalled when a job is queued or the helpers have to stop */
+    std::condition_variable queued;
+    /** @brief  Signalled when a job is finished */
+    std::condition_variable finished;
+    /** @brief  The jobs not started yet */
+    std::deque<Job> jobs;
+    /** @brief  Number of jobs queued or running for each parent */
+    std::unordered_map<RegKey*, int> pending;
+    /** @brief  True when the helpers have to stop */
+    bool stopping;
+
+    /**
+     * @fn  void work()
+     *
+     * @brief   Runs the jobs until the prefetcher is destroyed. Body of the helper threads.
+     *
+     * @date    2026.10.16.
+     */
+
+    void work()
+    {
+        timeline.nameThread("prefetch");
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            queued.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            {
+                PhaseSpan span(PHASE_OPEN);
+                std::chrono::steady_clock::time_point start = slowest.start();
+                RegKey* key = new RegKey(backend, job.parentKey, job.name.c_str(),
+                                         job.parent->getDepth() + 1, job.parent->getView());
+                slowest.record(SLOW_OPEN, start, job.parent->getPath(), job.name.c_str(), 0);
+                job.result.set_value(key);
+            }
+            lock.lock();
+            if (--pending[job.parent] == 0) {
+                pending.erase(job.parent);
+                finished.notify_all();
+            }
+        }
+    }
+public:
+
+    /**
+     * @fn  Prefetcher(RegistryBackend& backend, int threadCount)
+     *
+     * @brief   Starts the helper threads
+     *
+     * @date    2026.10.16.
+     *
+     * @param [in,out]  backend     The registry the keys are opened in.
+     * @param           threadCount Number of helper threads, 0 disables prefetching.
+     */
+
+    Prefetcher(RegistryBackend& backend, int threadCount) : backend(backend)
+    {
+        stopping = false;
+        for (int i = 0; i < threadCount; i++) {
+            threads.push_back(std::thread(&Prefetcher::work, this));
+        }
+    }
+
+    ~Prefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queued.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    /** @brief  Number of siblings opened ahead, one per helper thread */
+    size_t getDepth()
+    {
+        return threads.size();
+    }
+
+    /**
+     * @fn  std::future<RegKey*> open(RegKey* parent, const std::wstring& name)
+     *
+     * @brief   Queues the opening of a subkey
+     *
+     * The parent has to stay open until the job is finished, see drain().
+     *
+     * @date    2026.10.16.
+     *
+     * @param [in,out]  parent  The key the subkey is opened under.
+     * @param           name    The name of the subkey.
+     *
+     * @return  The future receiving the key, which is owned by the caller.
+     */
+
+    std::future<RegKey*> open(RegKey* parent, const std::wstring& name)
+    {
+        Job job = { parent, parent->getKey(), name, std::promise<RegKey*>() };
+        std::future<RegKey*> result = job.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending[parent]++;
+            jobs.push_back(std::move(job));
+        }
+        queued.notify_one();
+        return result;
+    }
+
+    /**
+     * @fn  void drain(RegKey* parent)
+     *
+     * @brief   Waits until every subkey queued under a key is opened
+     *
+     * @date    2026.10.16.
+     *
+     * @param [in,out]  parent  The key about to be closed.
+     */
+
+    void drain(RegKey* parent)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this, parent] { return pending.count(parent) == 0; });
+    }
+};
+
+/**
+ * @class   PrefetchWindow
+ *
+ * @brief   The siblings opened ahead while iterating over the subkeys of a key.
+ *
+ * Taking a subkey queues the ones up to the depth of the window after it.
+ * Subkeys left in the window are closed when it is destroyed.
+ *
+ * @date    2026.10.16.
+ */
+
+class PrefetchWindow {
+    /** @brief  Opens the subkeys */
+    Prefetcher& prefetcher;
+    /** @brief  The key being iterated */
+    RegKey* parent;
+    /** @brief  The names of the subkeys */
+    const std::vector<std::wstring>& names;
+    /** @brief  True for the subkeys which are not opened at all */
+    std::vector<bool> skipped;
+    /** @brief  The subkeys queued, by index */
+    std::vector<std::future<RegKey*>> keys;
+    /** @brief  Number of subkeys opened ahead */
+    size_t depth;
+    /** @brief  Index of the next subkey to queue */
+    size_t next;
+public:
+
+    PrefetchWindow(Prefetcher& prefetcher, RegKey* parent, const std::vector<std::wstring>& names,
+                   size_t first) : prefetcher(prefetcher), parent(parent), names(names),
+        skipped(names.size(), false), keys(names.size())
+    {
+        depth = prefetcher.getDepth();
+        next = first;
+    }
+
+    ~PrefetchWindow()
+    {
+        for (std::future<RegKey*>& key : keys) {
+            if (key.valid()) {
+                delete key.get();
+            }
+        }
+    }
+
+    /**
+     * @fn  void skip(size_t index)
+     *
+     * @brief   Excludes a subkey from prefetching
+     *
+     * @date    2026.10.16.
+     *
+     * @param   index   The index of the subkey.
+     */
+
+    void skip(size_t index)
+    {
+        skipped[index] = true;
+    }
+
+    /**
+     * @fn  RegKey* take(size_t index)
+     *
+     * @brief   Hands over a subkey and queues the following ones
+     *
+     * The parent has to be open.
+     *
+     * @date    2026.10.16.
+     *
+     * @param   index   The index of the subkey.
+     *
+     * @return  The opened subkey, or null if it was not prefetched.
+     */
+
+    RegKey* take(size_t index)
+    {
+        for (next = std::max(next, index + 1); depth > 0 && next < names.size() &&
+             next <= index + depth; next++) {
+            if (!skipped[next]) {
+                keys[next] = prefetcher.open(parent, names[next]);
+            }
+        }
+        if (!keys[index].valid()) {
+            return NULL;
+        }
+        return keys[index].get();
+    }
+};
+
+/**
+ * @struct  Replacement
+ *
+ * @brief   A matching value and what it is replaced with.
+ */
+
+struct Replacement {
+    std::wstring valueName;
+    /** @brief  The type the value was stored with */
+    DWORD type;
+    /** @brief  The value as compared, expanded for REG_EXPAND_SZ */
+    std::wstring before;
+    std::wstring after;
+};
+
+/**
+ * @class   MatchReport
+ *
+ * @brief   Writes one JSON line per match to a file.
+ *
+ * Every record holds the full path of the key, the value name, its type,
+ * the old and the new value, the outcome and the UTC time, e.g.
+ * {"path":"HKEY_CURRENT_USER\\Environment","value":"TEMP","type":"REG_EXPAND_SZ",
+ * "old":"...","new":"...","status":"replaced","time":"2026-10-16T12:00:00.000Z"}.
+ * The records are encoded straight into a buffer of REPORT_BUFFER bytes,
+ * allocated once, which is written out whenever it is full, so the memory
+ * used does not depend on the number or the size of the matches.
+ *
+ * @date    2026.10.16.
+ */
+
+class MatchReport {
+    /** @brief  The report file, or null if no report is written */
+    FILE* file = NULL;
+    /** @brief  Encoded records not written yet */
+    std::vector<char> buffer;
+    /** @brief  Number of bytes used in the buffer */
+    size_t used = 0;
+    /** @brief  Number of records added */
+    unsigned long long records = 0;
+    /** @brief  True if writing the file failed */
+    bool failed = false;
+    /** @brief  The second the cached time stamp belongs to */
+    std::time_t second = 0;
+    /** @brief  The time stamp up to the seconds, formatted once per second */
+    char stamp[32] = "";
+
+    void put(char c)
+    {
+        if (used == buffer.size()) {
+            flush();
+        }
+        buffer[used++] = c;
+    }
+
+    void put(const char* text)
+    {
+        while (*text != 0) {
+            put(*text++);
+        }
+    }
+
+    /* Puts a string in quotes, escaped and encoded as UTF-8 */
+    void put(const wchar_t* text, size_t length)
+    {
+        static const char hex[] = "0123456789abcdef";
+        put('"');
+        for (size_t i = 0; i < length; i++) {
+            wchar_t c = text[i];
+            if (c == L'"' || c == L'\\') {
+                put('\\');
+                put((char)c);
+            }
+            else if (c < 0x20) {
+                put("\\u00");
+                put(hex[c >> 4]);
+                put(hex[c & 0xF]);
+            }
+            else {
+                char bytes[4];
+                size_t count = encodeUtf8(text, length, i, bytes);
+                for (size_t j = 0; j < count; j++) {
+                    put(bytes[j]);
+                }
+            }
+        }
+        put('"');
+    }
+
+    void putTime()
+    {
+        std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+        std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+        if (seconds != second || stamp[0] == 0) {
+            std::tm parts;
+#ifdef _WIN32
+            gmtime_s(&parts, &seconds);
+#else
+            gmtime_r(&seconds, &parts);
+#endif
+            strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &parts);
+            second = seconds;
+        }
+        char milliseconds[8];
+        snprintf(milliseconds, sizeof(milliseconds), ".%03dZ",
+                 (int)(std::chrono::duration_cast<std::chrono::milliseconds>
+                       (now.time_since_epoch()).count() % 1000));
+        put('"');
+        put(stamp);
+        put(milliseconds);
+        put('"');
+    }
+
+    static const char* typeName(DWORD type)
+    {
+        return (type == REG_EXPAND_SZ) ? "REG_EXPAND_SZ" : (type == REG_MULTI_SZ) ? "REG_MULTI_SZ" :
+               "REG_SZ";
+    }
+public:
+    ~MatchReport()
+    {
+        close();
+    }
+
+    /**
+     * @fn  bool open(const std::wstring& fileName, bool append)
+     *
+     * @brief   Creates the report file
+     *
+     * @date    2026.10.16.
+     *
+     * @param   fileName    The report file.
+     * @param   append      True to continue the report of an earlier run.
+     *
+     * @return  True if it succeeds, false if the file could not be opened.
+     */
+
+    bool open(const std::wstring& fileName, bool append)
+    {
+#ifdef _WIN32
+        file = _wfopen(fileName.c_str(), append ? L"ab" : L"wb");
+#else
+        file = fopen(std::filesystem::path(fileName).c_str(), append ? "ab" : "wb");
+#endif
+        if (file != NULL) {
+            buffer.resize(REPORT_BUFFER);
+        }
+        return file != NULL;
+    }
+
+    bool isOpen() const
+    {
+        return file != NULL;
+    }
+
+    unsigned long long getRecords() const
+    {
+        return records;
+    }
+
+    /**
+     * @fn  void add(const std::wstring& path, const Replacement& replacement, const char* status)
+     *
+     * @brief   Adds the record of a match
+     *
+     * @date    2026.10.16.
+     *
+     * @param   path        The full path of the key.
+     * @param   replacement The value and its replacement.
+     * @param   status      The outcome: replaced, denied or failed.
+     */
+
+    void add(const std::wstring& path, const Replacement& replacement, const char* status)
+    {
+        if (file == NULL) {
+            return;
+        }
+        put("{\"path\":");
+        put(path.c_str(), path.length());
+        put(",\"value\":");
+        put(replacement.valueName.c_str(), replacement.valueName.length());
+        put(",\"type\":\"");
+        put(typeName(replacement.type));
+        put("\",\"old\":");
+        put(replacement.before.c_str(), replacement.before.length());
+        put(",\"new\":");
+        put(replacement.after.c_str(), replacement.after.length());
+        put(",\"status\":\"");
+        put(status);
+        put("\",\"time\":");
+        putTime();
+        put("}\n");
+        records++;
+    }
+
+    /**
+     * @fn  void flush()
+     *
+     * @brief   Writes the buffered records to the file
+     *
+     * @date    2026.10.16.
+     */
+
+    void flush()
+    {
+        if (file != NULL && used > 0) {
+            failed = failed || fwrite(buffer.data(), 1, used, file) != used || fflush(file) != 0;
+        }
+        used = 0;
+    }
+
+    /**
+     * @fn  bool close()
+     *
+     * @brief   Writes the buffered records and closes the file
+     *
+     * @date    2026.10.16.
+     *
+     * @return  True if every record was written.
+     */
+
+    bool close()
+    {
+        if (file == NULL) {
+            return !failed;
+        }
+        flush();
+        failed = (fclose(file) != 0) || failed;
+        file = NULL;
+        return !failed;
+    }
+};
+
+/**
+ * @class   FoldedStacks
+ *
+ * @brief   Attributes the time and the registry calls of the traversal to the key paths.
+ *
+ * Every key traversed adds one line per file in the folded stack format
+ * of flame graph tools: the path with ; between the keys, a space and the
+ * time (in nanoseconds) or the number of calls spent on the key itself,
+ * without its subkeys. Opening a key counts towards its parent. The calls
+ * of the prefetching threads count towards the key traversed meanwhile.
+ *
+ * @date    2026.10.16.
+ */
+
+class FoldedStacks {
+    /**
+     * @struct  Frame
+     *
+     * @brief   A key being traversed.
+     */
+
+    struct Frame {
+        std::chrono::steady_clock::time_point start;
+        /** @brief  The number of registry calls when the key was entered */
+        unsigned long long calls;
+        /** @brief  Time spent in the subkeys in nanoseconds */
+        uint64_t childTime;
+        /** @brief  Registry calls made in the subkeys */
+        unsigned long long childCalls;
+    };
+
+    std::ofstream timeFile;
+    std::ofstream callsFile;
+    /** @brief  The keys being traversed, root first */
+    std::vector<Frame> frames;
+    /** @brief  The path of the last key left, in the folded format */
+    std::string stack;
+
+    static bool openFile(std::ofstream& file, const std::wstring& fileName, bool append)
+    {
+        if (!fileName.empty()) {
+            file.open(std::filesystem::path(fileName), append ? std::ios::app : std::ios::trunc);
+            return file.is_open();
+        }
+        return true;
+    }
+public:
+
+    /**
+     * @fn  bool open(const std::wstring& timeName, const std::wstring& callsName, bool append)
+     *
+     * @brief   Creates the files
+     *
+     * @date    2026.10.16.
+     *
+     * @param   timeName    The file of the time spent, empty for none.
+     * @param   callsName   The file of the registry calls, empty for none.
+     * @param   append      True to continue the files of an earlier run.
+     *
+     * @return  True if it succeeds, false if a file could not be opened.
+     */
+
+    bool open(const std::wstring& timeName, const std::wstring& callsName, bool append)
+    {
+        return openFile(timeFile, timeName, append) && openFile(callsFile, callsName, append);
+    }
+
+    bool isOpen() const
+    {
+        return timeFile.is_open() || callsFile.is_open();
+    }
+
+    void enter(unsigned long long calls)
+    {
+        frames.push_back(Frame{ std::chrono::steady_clock::now(), calls, 0, 0 });
+    }
+
+    /**
+     * @fn  void leave(const std::wstring& path, unsigned long long calls)
+     *
+     * @brief   Writes the lines of the key traversed last and adds it to its parent
+     *
+     * @date    2026.10.16.
+     *
+     * @param   path    The full path of the key.
+     * @param   calls   The number of registry calls so far.
+     */
+
+    void leave(const std::wstring& path, unsigned long long calls)
+    {
+        Frame frame = frames.back();
+        frames.pop_back();
+        uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>
+                        (std::chrono::steady_clock::now() - frame.start).count();
+        calls -= frame.calls;
+        if (!frames.empty()) {
+            frames.back().childTime += time;
+            frames.back().childCalls += calls;
+        }
+        stack.clear();
+        for (size_t i = 0; i < path.length(); i++) {
+            if (path[i] == L'\\' || path[i] == L';') {
+                /* A ; within a key name would split it */
+                stack += (path[i] == L'\\') ? ';' : ':';
+            }
+            else {
+                char bytes[4];
+                stack.append(bytes, encodeUtf8(path.c_str(), path.length(), i, bytes));
+            }
+        }
+        if (timeFile.is_open()) {
+            timeFile << stack << ' ' << time - std::min(frame.childTime, time) << '\n';
+        }
+        if (callsFile.is_open() && calls > frame.childCalls) {
+            callsFile << stack << ' ' << calls - frame.childCalls << '\n';
+        }
+    }
+
+    /**
+     * @fn  bool close()
+     *
+     * @brief   Writes the buffered lines and closes the files
+     *
+     * @date    2026.10.16.
+     *
+     * @return  True if every line was written.
+     */
+
+    bool close()
+    {
+        bool succeeded = true;
+        for (std::ofstream* file : { &timeFile, &callsFile }) {
+            if (file->is_open()) {
+                file->close();
+                succeeded = succeeded && !file->fail();
+            }
+        }
+        return succeeded;
+    }
+};
+
+/**
+ * @struct  ProgressCounters
+ *
+ * @brief   Totals of a traversal sampled by the progress reporter and the metrics exporter.
+ *
+ * Only the traversing thread writes them, so a relaxed load and store is
+ * enough and the traversal never waits for the reporter.
+ *
+ * @date    2026.10.16.
+ */
+
+struct ProgressCounters {
+    /** @brief  Number of keys visited */
+    std::atomic<uint64_t> keys{ 0 };
+    /** @brief  Number of values enumerated */
+    std::atomic<uint64_t> values{ 0 };
+    /** @brief  Number of value bytes read */
+    std::atomic<uint64_t> bytes{ 0 };
+    /** @brief  Number of values which match */
+    std::atomic<uint64_t> matches{ 0 };
+    /** @brief  Number of matching values replaced */
+    std::atomic<uint64_t> replaced{ 0 };
+    /** @brief  Number of matching values not replaced because writing was denied */
+    std::atomic<uint64_t> denied{ 0 };
+    /** @brief  Number of matching values which could not be replaced for another reason */
+    std::atomic<uint64_t> failed{ 0 };
+    /** @brief  Index of the hive being traversed, SIZE_MAX before the hives are */
+    std::atomic<size_t> hive{ SIZE_MAX };
+    /** @brief  Estimated share of the hive already traversed, as of the last key entered */
+    std::atomic<double> coverage{ 0 };
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t amount)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @struct  ScanState
+ *
+ * @brief   State of a traversal shared by all hives.
+ *
+ * @date    2026.10.16.
+ */
+
+struct ScanState {
+    /** @brief  The command line settings */
+    const Options& options;
+    /** @brief  The registry being traversed */
+    RegistryBackend& backend;
+    /** @brief  Number of values which match */
+    int count = 0;
+    /** @brief  Number of keys visited so far */
+    unsigned long long keysVisited = 0;
+    /** @brief  Index of the hive being traversed */
+    size_t hive = 0;
+    /** @brief  Current key path, one entry per level */
+    std::vector<ResumePoint> position;
+    /** @brief  Key path loaded from the checkpoint */
+    std::vector<ResumePoint> resumePath;
+    /** @brief  True while the traversal still follows the loaded key path */
+    bool resuming = false;
+    /** @brief  Time of the last checkpoint */
+    std::chrono::steady_clock::time_point lastCheckpoint = std::chrono::steady_clock::now();
+    /** @brief  Limits the rate of the traversal */
+    Throttle throttle;
+    /** @brief  Time when the traversal has to stop */
+    std::chrono::steady_clock::time_point deadline;
+    /** @brief  True if the traversal stopped before finishing */
+    bool stopped = false;
+    /** @brief  Estimated share of each hive already traversed, between 0 and 1 */
+    std::vector<double> coverage;
+    /** @brief  Decides which subtrees are traversed */
+    PathFilter filter;
+    /** @brief  Number of subtrees skipped by the filter without opening them */
+    unsigned long long prunedKeys = 0;
+    /** @brief  Upper case physical names of the known locations already processed */
+    std::set<std::wstring> processedLocations;
+    /** @brief  Number of keys found to be shared between the 64-bit and 32-bit view */
+    unsigned long long sharedKeys = 0;
+    /** @brief  Upper case physical names of the keys with subkeys visited so far */
+    std::unordered_set<std::wstring> visited;
+    /** @brief  Number of keys skipped because they were already visited */
+    unsigned long long duplicateKeys = 0;
+    /** @brief  The symbolic links found, as path and target */
+    std::vector<std::pair<std::wstring, std::wstring>> links;
+    /** @brief  The keys on the current path, root first */
+    std::vector<RegKey*> openPath;
+    /** @brief  Number of key handles currently open */
+    unsigned long openHandles = 0;
+    /** @brief  Highest number of key handles open at the same time */
+    unsigned long peakHandles = 0;
+    /** @brief  Number of times an ancestor had to be opened again */
+    unsigned long long handleReopens = 0;
+    /** @brief  Number of matching values not replaced because writing was denied */
+    unsigned long long deniedWrites = 0;
+    /** @brief  Opens the next siblings ahead of the traversal */
+    Prefetcher prefetcher;
+    /** @brief  Records every match */
+    MatchReport report;
+    /** @brief  Attributes the time and the calls to the key paths */
+    FoldedStacks folded;
+    /** @brief  Sampled by the progress line */
+    ProgressCounters progress;
+
+    ScanState(const Options& options, RegistryBackend& backend) : options(options),
+        backend(backend), throttle(options.keysPerSecond, options.cpuPercent),
+        prefetcher(backend, options.prefetch >= 0 ? options.prefetch : backend.defaultPrefetch())
+    {
+        backend.setProbing(options.enumeration.empty() ? backend.probesByDefault() :
+                           options.enumeration == L"probe");
+        for (const std::wstring& glob : options.includes) {
+            filter.include(glob);
+            if (options.wow64 && !wow64Variant(glob).empty()) {
+                filter.include(wow64Variant(glob));
+            }
+        }
+        for (const std::wstring& glob : options.excludes) {
+            filter.exclude(glob);
+            if (options.wow64 && !wow64Variant(glob).empty()) {
+                filter.exclude(wow64Variant(glob));
+            }
+        }
+    }
+};
+
+/**
+ * @class   FoldedFrame
+ *
+ * @brief   Attributes the time until it goes out of scope to a key in the folded stacks.
+ *
+ * @date    2026.10.16.
+ */
+
+class FoldedFrame {
+    ScanState& state;
+    RegKey* key;
+public:
+    FoldedFrame(ScanState& state, RegKey* key) : state(state), key(key)
+    {
+        if (state.folded.isOpen()) {
+            state.folded.enter(state.backend.getCallCount());
+        }
+    }
+
+    ~FoldedFrame()
+    {
+        if (state.folded.isOpen()) {
+            state.folded.leave(key->getPath(), state.backend.getCallCount());
+        }
+    }
+};
+
+/**
+ * @class   ProgressReporter
+ *
+ * @brief   Rewrites a progress line on the standard error a few times a second while it exists.
+ *
+ * The rates are smoothed over the last samples. The time left in the hive is
+ * extrapolated from the share of it traversed since it was entered, as the
+ * subkey counts of the keys on the current path estimate it.
+ *
+ * @date    2026.10.16.
+ */
+
+class ProgressReporter {
+    /** @brief  The counters of one sample */
+    struct Sample {
+        uint64_t keys;
+        uint64_t values;
+        uint64_t bytes;
+        uint64_t matches;
+    };
+
+    ScanState& state;
+    /** @brief  Prints the line, only started with --progress */
+    std::thread reporter;
+    std::mutex mutex;
+    /** @brief  Signalled when the reporter has to stop */
+    std::condition_variable wakeup;
+    bool stopping = false;
+    /** @brief  Length of the line last printed, what is left of it is blanked */
+    size_t lineLength = 0;
+
+    Sample sample() const
+    {
+        const ProgressCounters& progress = state.progress;
+        return Sample{ progress.keys.load(std::memory_order_relaxed),
+                       progress.values.load(std::memory_order_relaxed),
+                       progress.bytes.load(std::memory_order_relaxed),
+                       progress.matches.load(std::memory_order_relaxed) };
+    }
+
+    /**
+     * @fn  static std::string formatDuration(double seconds)
+     *
+     * @brief   Formats a duration as [h:]mm:ss
+     *
+     * @date    2026.10.16.
+     *
+     * @param   seconds The duration.
+     *
+     * @return  The formatted duration.
+     */
+
+    static std::string formatDuration(double seconds)
+    {
+        long long total = std::llround(seconds);
+        char text[32];
+        if (total >= 3600) {
+            snprintf(text, sizeof(text), "%lld:%02lld:%02lld", total / 3600, total / 60 % 60, total % 60);
+        }
+        else {
+            snprintf(text, sizeof(text), "%lld:%02lld", total / 60, total % 60);
+        }
+        return text;
+    }
+
+    void print(const std::string& line)
+    {
+        fprintf(stderr, "\r%-*s", (int)std::max(line.length(), lineLength), line.c_str());
+        fflush(stderr);
+        lineLength = line.length();
+    }
+
+    void run()
+    {
+        timeline.nameThread("progress");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point last = start, hiveStart = start;
+        Sample previous = sample();
+        size_t hive = SIZE_MAX;
+        double hiveCoverage = 0, keyRate = 0, valueRate = 0;
+        bool first = true;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wakeup.wait_for(lock, std::chrono::milliseconds(PROGRESS_INTERVAL_MS),
+                                [this] { return stopping; })) {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            Sample current = sample();
+            double seconds = std::max(std::chrono::duration<double>(now - last).count(), 1e-9);
+            double keys = (current.keys - previous.keys) / seconds;
+            double values = (current.values - previous.values) / seconds;
+            keyRate = first ? keys : keyRate + PROGRESS_SMOOTHING * (keys - keyRate);
+            valueRate = first ? values : valueRate + PROGRESS_SMOOTHING * (values - valueRate);
+            first = false;
+            previous = current;
+            last = now;
+            std::string line = state.options.fast ? "known locations" : "starting";
+            std::string eta = "--";
+            size_t currentHive = state.progress.hive.load(std::memory_order_acquire);
+            double coverage = std::min(state.progress.coverage.load(std::memory_order_relaxed), 1.0);
+            if (currentHive != hive) {
+                hive = currentHive;
+                hiveStart = now;
+                hiveCoverage = coverage;
+            }
+            if (hive < hiveCount) {
+                line.clear();
+                for (const TCHAR* c = hives[hive].shortName; *c != 0; c++) {
+                    line += (char)*c;
+                }
+                double progressed = coverage - hiveCoverage;
+                if (progressed > 0) {
+                    eta = formatDuration(std::chrono::duration<double>(now - hiveStart).count() *
+                                         (1 - coverage) / progressed);
+                }
+                char text[64];
+                snprintf(text, sizeof(text), " %zu/%zu %5.1f%% ETA %s", hive + 1, hiveCount,
+                         coverage * 100, eta.c_str());
+                line += text;
+            }
+            char text[160];
+            snprintf(text, sizeof(text), "  %.0f keys/s  %.0f values/s  %.1f MB  %llu matches",
+                     keyRate, valueRate, current.bytes / 1e6, (unsigned long long)current.matches);
+            print(line + text);
+        }
+        Sample current = sample();
+        char text[160];
+        snprintf(text, sizeof(text), "%llu keys, %llu values, %.1f MB, %llu matches in %s",
+                 (unsigned long long)current.keys, (unsigned long long)current.values,
+                 current.bytes / 1e6, (unsigned long long)current.matches,
+                 formatDuration(std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                start).count()).c_str());
+        print(text);
+        fputs("\n", stderr);
+    }
+public:
+    explicit ProgressReporter(ScanState& state) : state(state)
+    {
+        if (state.options.progress) {
+            reporter = std::thread(&ProgressReporter::run, this);
+        }
+    }
+
+    ~ProgressReporter()
+    {
+        if (!reporter.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        reporter.join();
+    }
+};
+
+/**
+ * @fn  uint64_t peakMemory()
+ *
+ * @brief   Finds the most physical memory the process used so far
+ *
+ * @date    2026.10.16.
+ *
+ * @return  The peak working set in bytes, 0 if it is not known.
+ */
+
+uint64_t peakMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    /* Reported in kilobytes */
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+/**
+ * @class   MetricsExporter
+ *
+ * @brief   Periodically writes the metrics of a scan as a Prometheus text file while it exists.
+ *
+ * The file is written under a temporary name and renamed over the previous
+ * one, so the node exporter never reads half of it. The counters are
+ * sampled like the progress line does; the call statistics are merged from
+ * the per-thread buffers of the instrumented backend.
+ *
+ * @date    2026.10.16.
+ */
+
+class MetricsExporter {
+    ScanState& state;
+    /** @brief  Writes the file, only started with --metrics */
+    std::thread exporter;
+    std::mutex mutex;
+    /** @brief  Signalled when the exporter has to stop */
+    std::condition_variable wakeup;
+    bool stopping = false;
+    /** @brief  Labels every series carries, the target of a remote scan */
+    std::string labels;
+
+    std::string series(const std::string& name, const std::string& extra = std::string()) const
+    {
+        if (labels.empty() && extra.empty()) {
+            return name;
+        }
+        return name + "{" + labels + (labels.empty() || extra.empty() ? "" : ",") + extra + "}";
+    }
+
+    static void describe(std::ostream& file, const char* name, const char* type, const char* help)
+    {
+        file << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    }
+
+    /**
+     * @fn  bool write(bool finished)
+     *
+     * @brief   Writes the current metrics and replaces the file with them
+     *
+     * @date    2026.10.16.
+     *
+     * @param   finished    True once the scan has ended.
+     *
+     * @return  True if it succeeds, false if the file could not be written.
+     */
+
+    bool write(bool finished)
+    {
+        static const char* quantiles[] = { "0.5", "0.9", "0.99", "0.999" };
+        static const double percentiles[] = { 50, 90, 99, 99.9 };
+        const ProgressCounters& progress = state.progress;
+        std::wstring temporary = state.options.metricsFile + L".tmp";
+        {
+            std::ofstream file(std::filesystem::path(temporary), std::ios::trunc);
+            if (!file) {
+                return false;
+            }
+            describe(file, "move_homedir_keys_visited_total", "counter", "Registry keys visited.");
+            file << series("move_homedir_keys_visited_total") << " " <<
+                 progress.keys.load(std::memory_order_relaxed) << "\n";
+            describe(file, "move_homedir_values_scanned_total", "counter", "Registry values enumerated.");
+            file << series("move_homedir_values_scanned_total") << " " <<
+                 progress.values.load(std::memory_order_relaxed) << "\n";
+            describe(file, "move_homedir_value_bytes_total", "counter", "Bytes of value data read.");
+            file << series("move_homedir_value_bytes_total") << " " <<
+                 progress.bytes.load(std::memory_order_relaxed) << "\n";
+            describe(file, "move_homedir_matches_total", "counter",
+                     "Values containing the old home directory.");
+            file << series("move_homedir_matches_total") << " " <<
+                 progress.matches.load(std::memory_order_relaxed) << "\n";
+            describe(file, "move_homedir_writes_total", "counter",
+                     "Matching values by outcome of the replacement.");
+            file << series("move_homedir_writes_total", "status=\"replaced\"") << " " <<
+                 progress.replaced.load(std::memory_order_relaxed) << "\n";
+            file << series("move_homedir_writes_total", "status=\"denied\"") << " " <<
+                 progress.denied.load(std::memory_order_relaxed) << "\n";
+            file << series("move_homedir_writes_total", "status=\"failed\"") << " " <<
+                 progress.failed.load(std::memory_order_relaxed) << "\n";
+            CallStatistics statistics;
+            if (state.backend.getCallStatistics(statistics)) {
+                describe(file, "move_homedir_registry_errors_total", "counter",
+                         "Failed registry calls by call and error code.");
+                for (int i = TRACE_OPEN; i <= TRACE_PHYSICAL_NAME; i++) {
+                    for (const std::pair<const LSTATUS, uint64_t>& code : statistics.errorCodes[i]) {
+                        file << series("move_homedir_registry_errors_total", std::string("call=\"") +
+                                       callNames[i] + "\",code=\"" + std::to_string(code.first) + "\"") <<
+                             " " << code.second << "\n";
+                    }
+                }
+                describe(file, "move_homedir_registry_call_duration_seconds", "summary",
+                         "Duration of the registry calls.");
+                for (int i = TRACE_OPEN; i <= TRACE_PHYSICAL_NAME; i++) {
+                    const LatencyHistogram& latencies = statistics.latencies[i];
+                    if (latencies.getCount() == 0) {
+                        continue;
+                    }
+                    std::string call = std::string("call=\"") + callNames[i] + "\"";
+                    for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+                        file << series("move_homedir_registry_call_duration_seconds",
+                                       call + ",quantile=\"" + quantiles[q] + "\"") << " " <<
+                             latencies.percentile(percentiles[q]) / 1e9 << "\n";
+                    }
+                    file << series("move_homedir_registry_call_duration_seconds_sum", call) << " " <<
+                         latencies.getSum() / 1e9 << "\n";
+                    file << series("move_homedir_registry_call_duration_seconds_count", call) << " " <<
+                         latencies.getCount() << "\n";
+                }
+            }
+            describe(file, "move_homedir_peak_memory_bytes", "gauge",
+                     "Most physical memory the process used so far.");
+            file << series("move_homedir_peak_memory_bytes") << " " << peakMemory() << "\n";
+            describe(file, "move_homedir_scan_finished", "gauge", "1 once the scan has ended.");
+            file << series("move_homedir_scan_finished") << " " << (finished ? 1 : 0) << "\n";
+            if (!file.flush()) {
+                return false;
+            }
+        }
+        return MoveFileEx(temporary.c_str(), state.options.metricsFile.c_str(),
+                          MOVEFILE_REPLACE_EXISTING) != FALSE;
+    }
+
+    void run()
+    {
+        timeline.nameThread("metrics");
+        std::unique_lock<std::mutex> lock(mutex);
+        do {
+            if (!write(false)) {
+                LOG(LOG_WARNING) << "Unable to write the metrics to " << state.options.metricsFile << "\n";
+            }
+        }
+        while (!wakeup.wait_for(lock, std::chrono::seconds(state.options.metricsInterval),
+                                [this] { return stopping; }));
+    }
+public:
+    explicit MetricsExporter(ScanState& state) : state(state)
+    {
+        if (state.options.metricsFile.empty()) {
+            return;
+        }
+        const std::wstring& target = state.options.target;
+        if (!target.empty()) {
+            labels = "target=\"";
+            for (size_t i = 0; i < target.length(); i++) {
+                char bytes[4];
+                if (target[i] == L'\\' || target[i] == L'"') {
+                    labels += '\\';
+                }
+                labels.append(bytes, encodeUtf8(target.c_str(), target.length(), i, bytes));
+            }
+            labels += "\"";
+        }
+        exporter = std::thread(&MetricsExporter::run, this);
+    }
+
+    ~MetricsExporter()
+    {
+        if (!exporter.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        exporter.join();
+        if (!write(true)) {
+            LOG(LOG_WARNING) << "Unable to write the metrics to " << state.options.metricsFile << "\n";
+        }
+    }
+};
+
+/**
+ * @fn  void writeNumber(std::ostream& stream, uint64_t number)
+ *
+ * @brief   Writes a little endian 64 bit number to a binary stream.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  stream  The stream to write to.
+ * @param           number  The number to write.
+ */
+
+void writeNumber(std::ostream& stream, uint64_t number)
+{
+    for (int i = 0; i < 8; i++) {
+        stream.put((char)((number >> (i * 8)) & 0xff));
+    }
+}
+
+/**
+ * @fn  bool readNumber(std::istream& stream, uint64_t& number)
+ *
+ * @brief   Reads a little endian 64 bit number from a binary stream.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  stream  The stream to read from.
+ * @param [out]     number  The number read.
+ *
+ * @return  True if it succeeds, false if the stream ended.
+ */
+
+bool readNumber(std::istream& stream, uint64_t& number)
+{
+    unsigned char bytes[8];
+    if (!stream.read((char*)bytes, sizeof(bytes))) {
+        return false;
+    }
+    number = 0;
+    for (int i = 7; i >= 0; i--) {
+        number = (number << 8) | bytes[i];
+    }
+    return true;
+}
+
+/**
+ * @fn  bool writeCheckpoint(ScanState& state)
+ *
+ * @brief   Saves the current position of the traversal.
+ *
+ * The file is written under a temporary name and renamed afterwards, so an
+ * interrupted write never destroys the previous checkpoint.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if it succeeds, false if it fails.
+ */
+
+bool writeCheckpoint(ScanState& state)
+{
+    std::wstring temporary = state.options.checkpointFile + L".tmp";
+    state.lastCheckpoint = std::chrono::steady_clock::now();
+    PhaseSpan span(PHASE_CHECKPOINT);
+    /* The matches before the checkpoint are not found again when resuming */
+    state.report.flush();
+    {
+        std::ofstream file(std::filesystem::path(temporary), std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        writeNumber(file, CHECKPOINT_MAGIC);
+        writeNumber(file, CHECKPOINT_VERSION);
+        writeNumber(file, state.hive);
+        writeNumber(file, (uint64_t)state.count);
+        writeNumber(file, state.keysVisited);
+        writeNumber(file, state.position.size());
+        for (const ResumePoint& point : state.position) {
+            writeNumber(file, point.index);
+            writeNumber(file, point.name.length());
+            for (wchar_t character : point.name) {
+                file.put((char)(character & 0xff));
+                file.put((char)((character >> 8) & 0xff));
+            }
+        }
+        if (!file.flush()) {
+            return false;
+        }
+    }
+    return MoveFileEx(temporary.c_str(), state.options.checkpointFile.c_str(),
+                      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+/**
+ * @fn  bool readCheckpoint(ScanState& state)
+ *
+ * @brief   Loads the position and the counters saved by a previous run.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if it succeeds, false if there is no usable checkpoint.
+ */
+
+bool readCheckpoint(ScanState& state)
+{
+    std::ifstream file(std::filesystem::path(state.options.checkpointFile), std::ios::binary);
+    uint64_t magic, version, hive, count, keysVisited, levels;
+    if (!file || !readNumber(file, magic) || magic != CHECKPOINT_MAGIC ||
+        !readNumber(file, version) || version != CHECKPOINT_VERSION ||
+        !readNumber(file, hive) || !readNumber(file, count) ||
+        !readNumber(file, keysVisited) || !readNumber(file, levels)) {
+        return false;
+    }
+    std::vector<ResumePoint> path;
+    for (uint64_t i = 0; i < levels; i++) {
+        uint64_t index, length;
+        if (!readNumber(file, index) || !readNumber(file, length) || length > MAX_KEY_LENGTH) {
+            return false;
+        }
+        ResumePoint point = { (DWORD)index, std::wstring() };
+        for (uint64_t j = 0; j < length; j++) {
+            unsigned char bytes[2];
+            if (!file.read((char*)bytes, sizeof(bytes))) {
+                return false;
+            }
+            point.name.push_back((wchar_t)(bytes[0] | (bytes[1] << 8)));
+        }
+        path.push_back(point);
+    }
+    state.hive = (size_t)hive;
+    state.count = (int)count;
+    state.keysVisited = keysVisited;
+    state.resumePath = path;
+    state.resuming = !path.empty();
+    return true;
+}
+
+/**
+ * @fn  void checkpointIfDue(ScanState& state)
+ *
+ * @brief   Writes a checkpoint if the configured interval has elapsed.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ */
+
+void checkpointIfDue(ScanState& state)
+{
+    if (state.options.checkpointInterval <= 0) {
+        return;
+    }
+    if (std::chrono::steady_clock::now() - state.lastCheckpoint <
+        std::chrono::seconds(state.options.checkpointInterval)) {
+        return;
+    }
+    if (!writeCheckpoint(state)) {
+        LOG(LOG_ERROR) << "Error: unable to write checkpoint " << state.options.checkpointFile << "\n";
+    }
+}
+
+/**
+ * @fn  bool deadlineReached(ScanState& state)
+ *
+ * @brief   Checks whether the time given for the traversal is up
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if the traversal has to stop.
+ */
+
+bool deadlineReached(ScanState& state)
+{
+    if (state.options.deadline > 0 && std::chrono::steady_clock::now() >= state.deadline) {
+        state.stopped = true;
+    }
+    return state.stopped;
+}
+
+/**
+ * @fn  bool checkpointMatches(const std::vector<std::wstring>& subkeys, const ResumePoint& point)
+ *
+ * @brief   Checks whether a saved position still describes the key.
+ *
+ * The registry may have changed since the checkpoint was written, in which
+ * case the subkey at the saved index is a different one.
+ *
+ * @date    2026.10.16.
+ *
+ * @param   subkeys The subkeys of the key the position belongs to, in traversal order.
+ * @param   point   The saved position.
+ *
+ * @return  True if the position can be resumed from, false if not.
+ */
+
+bool checkpointMatches(const std::vector<std::wstring>& subkeys, const ResumePoint& point)
+{
+    if (point.index >= subkeys.size()) {
+        return point.index == subkeys.size() && point.name.empty();
+    }
+    return point.name == subkeys[point.index];
+}
+
+/**
+ * @fn  bool isHighValue(const std::wstring& name)
+ *
+ * @brief   Checks whether a key is likely to lead to profile paths
+ *
+ * @date    2026.10.16.
+ *
+ * @param   name    The name of the key.
+ *
+ * @return  True if the key should be traversed before its siblings.
+ */
+
+bool isHighValue(const std::wstring& name)
+{
+    static const TCHAR* const highValueKeys[] = HIGH_VALUE_KEYS;
+    for (const TCHAR* highValue : highValueKeys) {
+        if (_tcsicmp(name.c_str(), highValue) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @fn  bool enumerateSubkeys(RegKey *keyHolder, std::vector<std::wstring>& subkeys)
+ *
+ * @brief   Collects the names of the subkeys in traversal order.
+ *
+ * Keys which usually contain profile paths come first, so a traversal cut
+ * short by a deadline still finds most of the matches. A probing backend
+ * enumerates until ERROR_NO_MORE_ITEMS instead of querying the count first.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  keyHolder   The key to enumerate.
+ * @param [out]     subkeys     The names of the subkeys.
+ *
+ * @return  True if it succeeds, false if it fails.
+ */
+
+bool enumerateSubkeys(RegKey *keyHolder, std::vector<std::wstring>& subkeys)
+{
+    PhaseSpan span(PHASE_ENUMERATE);
+    std::chrono::steady_clock::time_point start = slowest.start();
+    DWORD errValue;
+    TCHAR keyName[MAX_KEY_LENGTH + 1];
+    RegistryBackend& backend = keyHolder->getBackend();
+    bool probing = backend.isProbing();
+    if (!probing) {
+        subkeys.reserve(keyHolder->getSubkeyCount());
+    }
+    for (DWORD i = 0; probing || i < keyHolder->getSubkeyCount(); i++) {
+        DWORD maxKeyName = MAX_KEY_LENGTH + 1;
+        errValue = backend.enumKey(keyHolder->getKey(), i, keyName, &maxKeyName);
+        if ((probing && errValue == ERROR_NO_MORE_ITEMS) || errValue == ERROR_KEY_DELETED) {
+            /* A key deleted during the scan has no more subkeys to visit */
+            break;
+        }
+        if (errValue != ERROR_SUCCESS) {
+            LOG(LOG_ERROR) << "Error: " << errValue << "\n";
+            return false;
+        }
+        subkeys.push_back(keyName);
+    }
+    std::stable_partition(subkeys.begin(), subkeys.end(), isHighValue);
+    slowest.record(SLOW_ENUMERATE, start, keyHolder->getPath(), NULL, subkeys.size());
+    return true;
+}
+
+/**
+ * @fn  void makeRoom(ScanState& state)
+ *
+ * @brief   Closes ancestors until another handle fits into the budget
+ *
+ * The ancestors closest to the root are closed first, they are needed
+ * again the latest. The key on top of the path stays open. Subkeys being
+ * prefetched under an ancestor are waited for before it is closed.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ */
+
+void makeRoom(ScanState& state)
+{
+    for (size_t i = 0; state.options.maxHandles > 0 && state.openHandles >= state.options.maxHandles &&
+         i + 1 < state.openPath.size(); i++) {
+        if (state.openPath[i]->isOpen()) {
+            state.prefetcher.drain(state.openPath[i]);
+            state.openPath[i]->close();
+            state.openHandles--;
+        }
+    }
+}
+
+/**
+ * @fn  void countHandle(ScanState& state)
+ *
+ * @brief   Accounts for a newly opened handle
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ */
+
+void countHandle(ScanState& state)
+{
+    state.openHandles++;
+    state.peakHandles = std::max(state.peakHandles, state.openHandles);
+}
+
+/**
+ * @fn  void closeHandle(ScanState& state, RegKey *keyHolder)
+ *
+ * @brief   Closes a key and accounts for its handle
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state       The state of the traversal.
+ * @param [in,out]  keyHolder   The key to close.
+ */
+
+void closeHandle(ScanState& state, RegKey *keyHolder)
+{
+    if (keyHolder->isOpen()) {
+        keyHolder->close();
+        state.openHandles--;
+    }
+}
+
+/**
+ * @fn  bool ensureOpen(ScanState& state, RegKey *keyHolder)
+ *
+ * @brief   Reopens a key closed to stay within the handle budget
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state       The state of the traversal.
+ * @param [in,out]  keyHolder   The key whose handle is needed.
+ *
+ * @return  True if the key is open, false if it could not be reopened.
+ */
+
+bool ensureOpen(ScanState& state, RegKey *keyHolder)
+{
+    if (keyHolder->isOpen()) {
+        return true;
+    }
+    makeRoom(state);
+    PhaseSpan span(PHASE_OPEN);
+    std::chrono::steady_clock::time_point start = slowest.start();
+    if (!keyHolder->reopen()) {
+        LOG(LOG_ERROR) << "Error: unable to reopen " << keyHolder->getPath() << ": " <<
+                       keyHolder->getErrorCode() << "\n";
+        return false;
+    }
+    slowest.record(SLOW_OPEN, start, keyHolder->getPath(), NULL, 0);
+    state.handleReopens++;
+    countHandle(state);
+    return true;
+}
+
+/**
+ * @fn  bool firstVisit(ScanState& state, RegKey *keyHolder)
+ *
+ * @brief   Records the physical identity of a key and checks whether it is new
+ *
+ * Only keys with subkeys are recorded, the caller checks this after the
+ * enumeration: revisiting a leaf costs a few value reads, while revisiting
+ * an inner key could repeat a whole subtree or loop forever. The identity
+ * is the whole upper case physical name: a hash alone could collide and
+ * silently drop a subtree from the migration. Not called with --no-dedup:
+ * links are opened as links, so a traversal cannot loop without it.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state       The state of the traversal.
+ * @param [in,out]  keyHolder   The key about to be traversed.
+ *
+ * @return  True if the key was not visited before, a revisit is logged at the debug level.
+ */
+
+bool firstVisit(ScanState& state, RegKey *keyHolder)
+{
+    std::wstring physical = keyHolder->getPhysicalName();
+    if (physical.empty()) {
+        return true;
+    }
+    std::transform(physical.begin(), physical.end(), physical.begin(), towupper);
+    if (state.visited.insert(physical).second) {
+        return true;
+    }
+    LOG(LOG_DEBUG) << "Skipping " << keyHolder->getPath() << ", already visited as " << physical <<
+                   "\n";
+    return false;
+}
+
+/**
+ * @fn  bool processValues(RegKey *keyHolder, ScanState& state, bool replace, int& matches)
+ *
+ * @brief   Looks for the home directory in the string values of a key.
+ *
+ * A probing backend reads the type and data of each value together with
+ * its name and grows the buffer when a value does not fit, otherwise the
+ * buffer is sized from the metadata of the key and only string values are
+ * read. A symbolic link is recorded from its SymbolicLinkValue. The
+ * replacements are written after the enumeration, through a write handle
+ * opened only for keys with matches. Values of keys which deny write access
+ * are counted and left alone.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  keyHolder   The key whose values are processed.
+ * @param [in,out]  state       The state of the traversal.
+ * @param           replace     If false the matches are only counted.
+ * @param [in,out]  matches     Incremented for every value which matches.
+ *
+ * @return  True if it succeeds or stops at the deadline, false if it fails.
+ */
+
+bool processValues(RegKey *keyHolder, ScanState& state, bool replace, int& matches)
+{
+    DWORD errValue;
+    RegistryBackend& backend = keyHolder->getBackend();
+    bool probing = backend.isProbing();
+    std::vector<Replacement> writes;
+    std::vector<TCHAR> valueName(MAX_VALUE_NAME + 1);
+    /* Room for a terminating null the registry does not guarantee */
+    std::vector<BYTE> data((probing ? NAME_BUFFER : keyHolder->getLongestValueData()) +
+                           sizeof(WCHAR));
+    if (replace) {
+        LOG(LOG_DEBUG) << "Values for class " << keyHolder->getName() << ":\n";
+    }
+    PhaseSpan span(PHASE_FETCH);
+    for (DWORD i = 0; probing || i < keyHolder->getValueCount(); i++) {
+        if (deadlineReached(state)) {
+            break;
+        }
+        span.next(PHASE_FETCH);
+        std::chrono::steady_clock::time_point start = slowest.start();
+        DWORD maxKeyValue, type, size;
+        int attempts = 0;
+        do {
+            maxKeyValue = MAX_VALUE_NAME + 1;
+            size = (DWORD)data.size() - sizeof(WCHAR);
+            errValue = backend.enumValue(keyHolder->getKey(), i, valueName.data(), &maxKeyValue,
+                                         &type, probing ? data.data() : NULL, probing ? &size : NULL);
+            if (errValue == ERROR_MORE_DATA) {
+                data.resize(size + sizeof(WCHAR));
+            }
+        }
+        while (probing && errValue == ERROR_MORE_DATA && ++attempts <= VALUE_READ_RETRIES);
+        if ((probing && errValue == ERROR_NO_MORE_ITEMS) || errValue == ERROR_KEY_DELETED) {
+            break;
+        }
+        if (probing && errValue == ERROR_MORE_DATA) {
+            LOG(LOG_ERROR) << "Error: value " << i << " of " << keyHolder->getPath() <<
+                           " keeps growing, skipped\n";
+            continue;
+        }
+        if (errValue != ERROR_SUCCESS) {
+            LOG(LOG_ERROR) << "Error: " << errValue << "\n";
+            return false;
+        }
+        ProgressCounters::add(state.progress.values, 1);
+        if (replace) {
+            LOG(LOG_DEBUG) << i << ": " << valueName.data() << "\n";
+        }
+        if (type == REG_LINK && _tcsicmp(valueName.data(), LINK_VALUE_NAME) == 0) {
+            if (!probing) {
+                size = (DWORD)data.size() - sizeof(WCHAR);
+                backend.getValue(keyHolder->getKey(), valueName.data(), RRF_RT_ANY | RRF_NOEXPAND,
+                                 &type, data.data(), &size);
+            }
+            /* The target is not null terminated */
+            state.links.push_back(std::make_pair(keyHolder->getPath(),
+                                                 std::wstring((const WCHAR*)data.data(), size / sizeof(WCHAR))));
+            continue;
+        }
+        DWORD storedType = type;
+        /* Expandable strings are compared expanded, as RegGetValue returns them */
+        if (type == REG_EXPAND_SZ || (!probing && type == REG_SZ)) {
+            size = (DWORD)data.size();
+            attempts = 0;
+            while ((errValue = backend.getValue(keyHolder->getKey(), valueName.data(),
+                                                RRF_RT_REG_SZ, &type, data.data(), &size)) == ERROR_MORE_DATA &&
+                   ++attempts <= VALUE_READ_RETRIES) {
+                /* The expansion can be longer than the stored string, and the value can grow */
+                data.resize(size);
+            }
+            if (errValue == ERROR_KEY_DELETED || errValue == ERROR_FILE_NOT_FOUND) {
+                /* Deleted since it was enumerated */
+                continue;
+            }
+            if (errValue == ERROR_MORE_DATA) {
+                LOG(LOG_ERROR) << "Error: " << keyHolder->getPath() << "\\" << valueName.data() <<
+                               " keeps growing, skipped\n";
+                continue;
+            }
+            if (errValue != ERROR_SUCCESS) {
+                LOG(LOG_ERROR) << "Error during value retrival: " << errValue << "\n";
+                return false;
+            }
+        }
+        else if (type == REG_SZ) {
+            size -= size % sizeof(WCHAR);
+            memset(data.data() + size, 0, sizeof(WCHAR));
+        }
+        else {
+            /* Only read in probe mode, where large binary values are a usual suspect */
+            slowest.record(SLOW_VALUE, start, keyHolder->getPath(), valueName.data(),
+                           probing ? size : 0);
+            ProgressCounters::add(state.progress.bytes, probing ? size : 0);
+            continue;
+        }
+        span.next(PHASE_MATCH);
+        slowest.record(SLOW_VALUE, start, keyHolder->getPath(), valueName.data(), size);
+        ProgressCounters::add(state.progress.bytes, size);
+        const WCHAR* text = (const WCHAR*)data.data();
+        TRACE << "Comparing " << keyHolder->getPath() << "\\" << valueName.data() << ": " << text <<
+              "\n";
+        /*Only replace the string if it matches what we search for */
+        if (wcsstr(text, FROM_NAME) != NULL) {
+            matches++;
+            ProgressCounters::add(state.progress.matches, 1);
+            /* Every key reached by a traversal or a known location knows its hive */
+            if (TRACE_ENABLED && findHive(keyHolder->getPath().substr(0,
+                                          keyHolder->getPath().find(L'\\'))) == NULL) {
+                LOG(LOG_ERROR) << "Error: match reported without its full path: " <<
+                               keyHolder->getPath() << "\n";
+            }
+            if (!replace) {
+                continue;
+            }
+            LOG(LOG_INFO) << "key: " << keyHolder->getName() << " valueName: " << i << ": " <<
+                          valueName.data() << "\n";
+            std::wstring replaced(text);
+            replaced = Replace(replaced, FROM_NAME, TO_NAME);
+            LOG(LOG_INFO) << i << " value: " << text << "\n";
+            LOG(LOG_INFO) << i << " new value: " << replaced << "\n";
+            writes.push_back(Replacement{ valueName.data(), storedType, text, replaced });
+        }
+    }
+    if (writes.empty()) {
+        return true;
+    }
+    span.next(PHASE_WRITE);
+    HKEY writeKey;
+    if ((errValue = keyHolder->openForWrite(&writeKey)) != ERROR_SUCCESS) {
+        if (errValue != ERROR_ACCESS_DENIED) {
+            LOG(LOG_ERROR) << "Error: opening " << keyHolder->getPath() << " for writing: " <<
+                           errValue << "\n";
+            return false;
+        }
+        LOG(LOG_WARNING) << "Access denied, values not replaced in " << keyHolder->getPath() << "\n";
+        state.deniedWrites += writes.size();
+        ProgressCounters::add(state.progress.denied, writes.size());
+        for (const Replacement& write : writes) {
+            state.report.add(keyHolder->getPath(), write, "denied");
+        }
+        return true;
+    }
+    countHandle(state);
+    for (const Replacement& write : writes) {
+        DWORD setRes = backend.setValue(writeKey, write.valueName.c_str(), REG_SZ,
+                                        (LPBYTE)write.after.c_str(),
+                                        ((DWORD)write.after.length() + 1) * (DWORD)sizeof(WCHAR));
+        state.report.add(keyHolder->getPath(), write, setRes == ERROR_SUCCESS ? "replaced" :
+                         setRes == ERROR_ACCESS_DENIED ? "denied" : "failed");
+        if (setRes == ERROR_SUCCESS) {
+            ProgressCounters::add(state.progress.replaced, 1);
+        }
+        else if (setRes == ERROR_ACCESS_DENIED) {
+            state.deniedWrites++;
+            ProgressCounters::add(state.progress.denied, 1);
+        }
+        else {
+            ProgressCounters::add(state.progress.failed, 1);
+            errValue = setRes;
+            break;
+        }
+    }
+    backend.closeKey(writeKey);
+    state.openHandles--;
+    return errValue == ERROR_SUCCESS;
+}
+
+/**
+ * @fn  bool iter(RegKey *keyHolder, ScanState& state)
+ *
+ * @brief   Iterates over the subkeys and prints the values of the key. Recursive function.
+ *
+ * If it finds a matching value it replaces the home directory
+ * information in the value.
+ * Note: The extensive use of heap memory is to avoid stack overflow.
+ * When resuming, the subkeys finished before the checkpoint are skipped.
+ * The share of the hive belonging to the key is split evenly between its
+ * subkeys and its own values to estimate the coverage of a partial run.
+ * Subtrees rejected by the path filter are skipped before they are opened,
+ * keys already reached through another path are skipped after enumeration.
+ * With --prefetch the next siblings are opened on helper threads while a
+ * subtree is traversed.
+ *
+ * @date    2018.03.16.
+ *
+ * @param [in,out]  keyHolder   If non-null, the key holder.
+ * @param [in,out]  state       The state of the traversal, including the number of
+ *                              values which match.
+ * @param           share       The share of the hive belonging to the key.
+ * @param           filterState The state of the path filter at the key.
+ *
+ * @return  True if it succeeds or stops at the deadline, false if it fails.
+ */
+
+bool iter(RegKey *keyHolder, ScanState& state, double share, int filterState)
+{
+    size_t level = (size_t)keyHolder->getDepth();
+    if (keyHolder->getDepth() > MAX_DEPTH) {
+        LOG(LOG_ERROR) << "Error: maximum depth exceeded at " << keyHolder->getPath() << "\n";
+        state.coverage[state.hive] += share;
+        return true;
+    }
+    FoldedFrame frame(state, keyHolder);
+    std::optional<PhaseSpan> subtree;
+    if (timeline.isEnabled() && level <= TIMELINE_SUBTREE_DEPTH) {
+        subtree.emplace(PHASE_SUBTREE, keyHolder->getPath());
+    }
+    DWORD first = 0;
+    std::vector<std::wstring> subkeys;
+    if (!enumerateSubkeys(keyHolder, subkeys)) {
+        return false;
+    }
+    if (!subkeys.empty() && !state.options.noDedup && !firstVisit(state, keyHolder)) {
+        state.duplicateKeys++;
+        state.coverage[state.hive] += share;
+        return true;
+    }
+    state.keysVisited++;
+    ProgressCounters::add(state.progress.keys, 1);
+    state.progress.coverage.store(state.coverage[state.hive], std::memory_order_relaxed);
+    double childShare = share / (subkeys.size() + 1);
+    if (state.resuming) {
+        if (checkpointMatches(subkeys, state.resumePath[level])) {
+            first = state.resumePath[level].index;
+            state.resuming = (level + 1 < state.resumePath.size());
+        }
+        else {
+            LOG(LOG_WARNING) << "Checkpoint is out of date, rescanning " << keyHolder->getName() << "\n";
+            state.resuming = false;
+        }
+    }
+    /* Subkeys finished before the checkpoint */
+    state.coverage[state.hive] += first * childShare;
+    LOG(LOG_DEBUG) << "Iterating through (" << keyHolder->getDepth() << ") " <<
+                   keyHolder->getName() << ":\n";
+    /* The filter is applied up front, so pruned subkeys are not prefetched */
+    PrefetchWindow window(state.prefetcher, keyHolder, subkeys, first);
+    std::vector<int> childFilters(subkeys.size(), 0);
+    if (!state.filter.isEmpty()) {
+        for (size_t i = first; i < subkeys.size(); i++) {
+            childFilters[i] = state.filter.advance(filterState, subkeys[i]);
+            if (state.filter.prunes(childFilters[i])) {
+                window.skip(i);
+            }
+        }
+    }
+    for (DWORD i = first; i < subkeys.size(); i++) {
+        const TCHAR *keyName = subkeys[i].c_str();
+        state.position.resize(level + 1);
+        state.position[level] = { i, keyName };
+        if (deadlineReached(state)) {
+            return true;
+        }
+        checkpointIfDue(state);
+        int childFilter = childFilters[i];
+        if (!state.filter.isEmpty() && state.filter.prunes(childFilter)) {
+            state.prunedKeys++;
+            state.coverage[state.hive] += childShare;
+            state.resuming = false;
+            continue;
+        }
+        state.throttle.pace();
+        if (!ensureOpen(state, keyHolder)) {
+            return false;
+        }
+        makeRoom(state);
+        RegKey *subKey = window.take(i);
+        if (subKey == NULL) {
+            PhaseSpan span(PHASE_OPEN);
+            std::chrono::steady_clock::time_point start = slowest.start();
+            subKey = new RegKey(state.backend, keyHolder->getKey(), keyName,
+                                keyHolder->getDepth() + 1, keyHolder->getView());
+            slowest.record(SLOW_OPEN, start, keyHolder->getPath(), keyName, 0);
+        }
+        if (subKey->isValid()) {
+            countHandle(state);
+        }
+        /* This is to workaround registry virtualization */
+        if (!subKey->isValid() && subKey->getErrorCode() != ERROR_FILE_NOT_FOUND) {
+            if (subKey->getErrorCode() != ERROR_ACCESS_DENIED) {
+                LOG(LOG_ERROR) << "Error: creation of subkey " << keyName << "\n";
+            }
+            else {
+                TRACE << "Error: creation of subkey " << keyName << ": access denied\n";
+            }
+            /* Access denial should not be a problem here */
+            if (subKey->getErrorCode() != ERROR_ACCESS_DENIED) {
+                delete subKey;
+                return false;
+            }
+        }
+        LOG(LOG_DEBUG) << i << ": " << keyName << "\n";
+        subKey->setParent(keyHolder);
+        /* Only iterate through the key if it's valid */
+        if (subKey->isValid()) {
+            state.openPath.push_back(subKey);
+            bool succeeded = iter(subKey, state, childShare, childFilter);
+            state.openPath.pop_back();
+            if (!succeeded) {
+                closeHandle(state, subKey);
+                delete subKey;
+                return false;
+            }
+        }
+        else {
+            state.coverage[state.hive] += childShare;
+        }
+        /* Only the first subkey after a checkpoint continues the saved path */
+        state.resuming = false;
+        closeHandle(state, subKey);
+        delete subKey;
+        if (state.stopped) {
+            return true;
+        }
+    }
+    state.position.resize(level + 1);
+    state.position[level] = { (DWORD)subkeys.size(), std::wstring() };
+    if ((state.filter.isEmpty() || state.filter.selects(filterState)) &&
+        (!ensureOpen(state, keyHolder) ||
+         !processValues(keyHolder, state, !state.options.readOnly, state.count))) {
+        return false;
+    }
+    if (state.stopped) {
+        return true;
+    }
+    state.coverage[state.hive] += childShare;
+    return true;
+}
+
+/**
+ * @fn  bool sampleHive(HKEY root, ScanState& state, std::mt19937& random, double& mean,
+ *                      double& variance)
+ *
+ * @brief   Estimates the number of matching values in a hive from random paths.
+ *
+ * Every sample descends from the root to a leaf, choosing one subkey at each
+ * level uniformly. The matches of each key on the path are weighted by the
+ * product of the subkey counts above it, the inverse of the probability of
+ * reaching the key, which makes every sample an unbiased estimate of the
+ * matches in the whole hive (Knuth's estimator). Nothing is replaced.
+ *
+ * @date    2026.10.16.
+ *
+ * @param           root        Predefined handle of the hive.
+ * @param [in,out]  state       The state of the traversal.
+ * @param [in,out]  random      The random number generator.
+ * @param [out]     mean        The estimated number of matches.
+ * @param [out]     variance    The variance of the estimate.
+ *
+ * @return  True if it succeeds, false if the hive could not be opened.
+ */
+
+bool sampleHive(HKEY root, ScanState& state, std::mt19937& random, double& mean,
+                double& variance)
+{
+    double sum = 0, squares = 0;
+    int samples = state.options.samples;
+    for (int s = 0; s < samples; s++) {
+        double estimate = 0, weight = 1;
+        RegKey *key = new RegKey(state.backend, root, L"", 0);
+        if (!key->isValid()) {
+            delete key;
+            return false;
+        }
+        while (key->isValid()) {
+            int matches = 0;
+            state.keysVisited++;
+            if (!processValues(key, state, false, matches)) {
+                break;
+            }
+            estimate += weight * matches;
+            if (key->getSubkeyCount() == 0) {
+                break;
+            }
+            weight *= key->getSubkeyCount();
+            std::uniform_int_distribution<DWORD> pick(0, key->getSubkeyCount() - 1);
+            DWORD maxKeyName = MAX_KEY_LENGTH + 1;
+            TCHAR keyName[MAX_KEY_LENGTH + 1];
+            if (state.backend.enumKey(key->getKey(), pick(random), keyName,
+                                      &maxKeyName) != ERROR_SUCCESS) {
+                break;
+            }
+            RegKey *subKey = new RegKey(state.backend, key->getKey(), keyName,
+                                        key->getDepth() + 1, key->getView());
+            delete key;
+            key = subKey;
+        }
+        delete key;
+        sum += estimate;
+        squares += estimate * estimate;
+    }
+    mean = sum / samples;
+    /* Variance of the mean of the samples */
+    variance = (samples > 1) ? (squares - sum * mean) / (samples - 1) / samples : 0;
+    return true;
+}
+
+/**
+ * @struct  Location
+ *
+ * @brief   A known location of profile paths, read from the locations file.
+ *
+ * The path is split into steps: a literal step is a relative path opened
+ * with a single call, a "*" step stands for every subkey on that level.
+ *
+ * @date    2026.10.16.
+ */
+
+struct Location {
+    /** @brief  The hive the location is in */
+    const Hive* hive;
+    /** @brief  The steps from the root of the hive to the keys */
+    std::vector<std::wstring> steps;
+};
+
+/**
+ * @fn  bool loadLocations(const std::wstring& fileName, std::vector<Location>& locations)
+ *
+ * @brief   Reads the known locations from a file.
+ *
+ * Every line holds a key path starting with the hive, e.g.
+ * HKU\*\Environment. Empty lines and lines starting with # are ignored.
+ *
+ * @date    2026.10.16.
+ *
+ * @param           fileName    The file to read.
+ * @param [out]     locations   The locations read from the file.
+ *
+ * @return  True if it succeeds, false if the file is missing or malformed.
+ */
+
+bool loadLocations(const std::wstring& fileName, std::vector<Location>& locations)
+{
+    std::wifstream file{std::filesystem::path(fileName)};
+    if (!file) {
+        LOG(LOG_ERROR) << "Error: unable to open " << fileName << "\n";
+        return false;
+    }
+    std::wstring line;
+    while (std::getline(file, line)) {
+        line.erase(line.find_last_not_of(L" \t\r") + 1);
+        if (line.empty() || line[0] == L'#') {
+            continue;
+        }
+        size_t separator = line.find(L'\\');
+        Location location = { findHive(line.substr(0, separator)), std::vector<std::wstring>() };
+        if (location.hive == NULL) {
+            LOG(LOG_ERROR) << "Error: unknown hive in location " << line << "\n";
+            return false;
+        }
+        std::wstring literal;
+        while (separator != std::wstring::npos) {
+            size_t next = line.find(L'\\', separator + 1);
+            std::wstring segment = line.substr(separator + 1, next == std::wstring::npos ?
+                                               std::wstring::npos : next - separator - 1);
+            if (segment == L"*") {
+                if (!literal.empty()) {
+                    location.steps.push_back(literal);
+                    literal.clear();
+                }
+                location.steps.push_back(segment);
+            }
+            else if (!segment.empty()) {
+                literal += (literal.empty() ? L"" : L"\\") + segment;
+            }
+            separator = next;
+        }
+        if (!literal.empty()) {
+            location.steps.push_back(literal);
+        }
+        locations.push_back(location);
+    }
+    return true;
+}
+
+/**
+ * @fn  bool processLocation(RegKey *keyHolder, const Location& location, size_t step,
+ *                           ScanState& state)
+ *
+ * @brief   Opens the keys of a known location and replaces their values. Recursive function.
+ *
+ * Keys missing on this machine are skipped silently. With --wow64 the
+ * physical names of the keys are remembered, so a key reached again through
+ * the 32-bit view, because it is shared or reflected, is not processed twice.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  keyHolder   The key reached by the previous steps.
+ * @param           location    The location being processed.
+ * @param           step        Index of the next step.
+ * @param [in,out]  state       The state of the traversal.
+ *
+ * @return  True if it succeeds, false if it fails.
+ */
+
+bool processLocation(RegKey *keyHolder, const Location& location, size_t step,
+                     ScanState& state)
+{
+    if (step == location.steps.size()) {
+        if (state.options.wow64) {
+            std::wstring physical = keyHolder->getPhysicalName();
+            std::transform(physical.begin(), physical.end(), physical.begin(), towupper);
+            if (!physical.empty() && !state.processedLocations.insert(physical).second) {
+                state.sharedKeys++;
+                return true;
+            }
+        }
+        state.keysVisited++;
+        ProgressCounters::add(state.progress.keys, 1);
+        return processValues(keyHolder, state, !state.options.readOnly, state.count);
+    }
+    std::vector<std::wstring> names;
+    if (location.steps[step] == L"*") {
+        if (!enumerateSubkeys(keyHolder, names)) {
+            return false;
+        }
+    }
+    else {
+        names.push_back(location.steps[step]);
+    }
+    for (const std::wstring& name : names) {
+        RegKey subKey(state.backend, keyHolder->getKey(), name.c_str(),
+                      keyHolder->getDepth() + 1, keyHolder->getView());
+        subKey.setParent(keyHolder);
+        if (subKey.isValid() && !processLocation(&subKey, location, step + 1, state)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @fn  std::wstring executableDirectory()
+ *
+ * @brief   Retrieves the directory of the running executable
+ *
+ * @date    2026.10.16.
+ *
+ * @return  The directory including the trailing separator.
+ */
+
+std::wstring executableDirectory()
+{
+#ifdef _WIN32
+    TCHAR path[MAX_PATH];
+    DWORD length = GetModuleFileName(NULL, path, MAX_PATH);
+    std::wstring directory(path, length);
+    return directory.substr(0, directory.find_last_of(L'\\') + 1);
+#else
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", error);
+    return error ? std::wstring() : path.parent_path().wstring() + L"/";
+#endif
+}
+
+/**
+ * @fn  bool processKnownLocations(ScanState& state)
+ *
+ * @brief   Replaces the values in the known locations only
+ *
+ * This is the fast path meant to run synchronously at logon, it takes
+ * milliseconds instead of the minutes of a full traversal.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if it succeeds, false if it fails.
+ */
+
+bool processKnownLocations(ScanState& state)
+{
+    std::wstring fileName = state.options.locationsFile.empty() ?
+                            executableDirectory() + LOCATIONS_FILE : state.options.locationsFile;
+    std::vector<Location> locations;
+    if (!loadLocations(fileName, locations)) {
+        return false;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    PhaseSpan span(PHASE_LOCATIONS);
+    std::vector<REGSAM> views(1, KEY_WOW64_64KEY);
+    if (state.options.wow64) {
+        views.push_back(KEY_WOW64_32KEY);
+    }
+    for (REGSAM view : views) {
+        for (const Location& location : locations) {
+            if (!state.backend.hasHive(location.hive->key)) {
+                continue;
+            }
+            RegKey root(state.backend, location.hive->key, L"", 0, view);
+            root.setHive(location.hive->name);
+            if (!root.isValid() || !processLocation(&root, location, 0, state)) {
+                return false;
+            }
+        }
+    }
+    LOG(LOG_INFO) << "Known locations processed in " <<
+                  std::chrono::duration_cast<std::chrono::milliseconds>
+                  (std::chrono::steady_clock::now() - start).count() << " ms\n";
+    if (state.options.wow64) {
+        LOG(LOG_INFO) << "Keys shared by the 64-bit and 32-bit view: " << state.sharedKeys << "\n";
+    }
+    return true;
+}
+
+/**
+ * @fn  std::wstring quoteArgument(const std::wstring& argument)
+ *
+ * @brief   Quotes an argument so the command line parser of the C runtime restores it
+ *
+ * @date    2026.10.16.
+ *
+ * @param   argument    The argument.
+ *
+ * @return  The argument, quoted if it is empty or has white space or quotes.
+ */
+
+std::wstring quoteArgument(const std::wstring& argument)
+{
+    if (!argument.empty() && argument.find_first_of(L" \t\n\v\"") == std::wstring::npos) {
+        return argument;
+    }
+    std::wstring quoted = L"\"";
+    size_t backslashes = 0;
+    for (wchar_t character : argument) {
+        if (character == L'\\') {
+            backslashes++;
+            continue;
+        }
+        /* Backslashes only escape when they precede a quote */
+        quoted.append(character == L'"' ? backslashes * 2 + 1 : backslashes, L'\\');
+        quoted += character;
+        backslashes = 0;
+    }
+    quoted.append(backslashes * 2, L'\\');
+    return quoted + L"\"";
+}
+
+/**
+ * @fn  std::wstring insertBeforeExtension(const std::wstring& fileName, const std::wstring& name)
+ *
+ * @brief   Names a file of its own for a part of the scan, keeping the extension last
+ *
+ * The node exporter only reads files ending in .prom, so the metrics files
+ * are told apart this way rather than by a suffix.
+ *
+ * @date    2026.10.16.
+ *
+ * @param   fileName    The file name given on the command line.
+ * @param   name        The part of the scan, a machine or DEFERRED_SUFFIX.
+ *
+ * @return  The file name with the name inserted before the extension.
+ */
+
+std::wstring insertBeforeExtension(const std::wstring& fileName, const std::wstring& name)
+{
+    std::filesystem::path path(fileName);
+    return (path.parent_path() / path.stem()).wstring() + L"." + name + path.extension().wstring();
+}
+
+/**
+ * @fn  bool startDeferredTraversal(const Options& options)
+ *
+ * @brief   Starts a detached copy of the program traversing the whole registry
+ *
+ * The copy gets the same arguments except the ones selecting the known
+ * locations, and runs in background mode, so logon is not slowed down by
+ * it. The files the scan writes get a .deferred suffix, as this process
+ * still writes its own; the checkpoint is left alone, it is only used by
+ * the full traversal. The copy has no console, so without --log it logs to
+ * DEFERRED_LOG_FILE.
+ *
+ * @date    2026.10.16.
+ *
+ * @param   options The command line settings.
+ *
+ * @return  True if the process was started, false if not.
+ */
+
+bool startDeferredTraversal(const Options& options)
+{
+#ifndef _WIN32
+    /* Only a Windows build can start the process */
+    (void)options;
+    return false;
+#else
+    TCHAR path[MAX_PATH];
+    GetModuleFileName(NULL, path, MAX_PATH);
+    static const wchar_t* outputs[] = { L"--log", L"--report", L"--record", L"--timeline",
+                                        L"--folded", L"--folded-calls", L"--call-stats"
+                                      };
+    std::wstring commandLine = std::wstring(L"\"") + path + L"\"";
+    const std::vector<std::wstring>& arguments = options.arguments;
+    for (size_t i = 0; i < arguments.size(); i++) {
+        const std::wstring& argument = arguments[i];
+        if (argument == L"--fast" || argument == L"--full" || argument == L"--defer-full") {
+            continue;
+        }
+        commandLine += L" " + quoteArgument(argument);
+        if (i + 1 >= arguments.size()) {
+            continue;
+        }
+        if (argument == L"--metrics") {
+            commandLine += L" " + quoteArgument(insertBeforeExtension(arguments[++i], DEFERRED_SUFFIX));
+        }
+        else if (std::find(outputs, outputs + sizeof(outputs) / sizeof(outputs[0]), argument) !=
+                 outputs + sizeof(outputs) / sizeof(outputs[0])) {
+            commandLine += L" " + quoteArgument(arguments[++i] + L"." DEFERRED_SUFFIX);
+        }
+    }
+    if (!options.background) {
+        commandLine += L" --background";
+    }
+    if (options.logFile.empty()) {
+        commandLine += std::wstring(L" --log ") + DEFERRED_LOG_FILE;
+    }
+    STARTUPINFO startupInfo = { sizeof(startupInfo) };
+    PROCESS_INFORMATION processInfo;
+    if (!CreateProcess(path, &commandLine[0], NULL, NULL, FALSE,
+                       DETACHED_PROCESS | CREATE_NEW_PROCESS_GROUP, NULL, NULL,
+                       &startupInfo, &processInfo)) {
+        return false;
+    }
+    LOG(LOG_INFO) << "Full traversal continues in the background (process " <<
+                  processInfo.dwProcessId << ")\n";
+    CloseHandle(processInfo.hThread);
+    CloseHandle(processInfo.hProcess);
+    return true;
+#endif
+}
+
+/**
+ * @fn  bool isWithin(const std::wstring& name, const std::wstring& root)
+ *
+ * @brief   Checks whether a physical key name is strictly below another one
+ *
+ * @date    2026.10.16.
+ *
+ * @param   name    The physical name of the key.
+ * @param   root    The physical name of the possible ancestor.
+ *
+ * @return  True if the key is a descendant of the root.
+ */
+
+bool isWithin(const std::wstring& name, const std::wstring& root)
+{
+    return !root.empty() && name.length() > root.length() && name[root.length()] == L'\\' &&
+           _tcsnicmp(name.c_str(), root.c_str(), root.length()) == 0;
+}
+
+/**
+ * @fn  std::vector<bool> findAliases(ScanState& state)
+ *
+ * @brief   Finds the hives which are only views of other hives
+ *
+ * HKEY_CURRENT_USER is HKEY_USERS\<SID>, HKEY_CURRENT_CONFIG is a link below
+ * HKEY_LOCAL_MACHINE\SYSTEM and HKEY_CLASSES_ROOT merges the classes of
+ * HKEY_LOCAL_MACHINE and HKEY_CURRENT_USER. Instead of relying on this
+ * list, the physical names of the hives are compared, and a hive is an alias
+ * if every part of it lies below a hive which is traversed anyway. Hives
+ * named explicitly by an include glob are always traversed.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True for every hive which can be skipped.
+ */
+
+std::vector<bool> findAliases(ScanState& state)
+{
+    const Options& options = state.options;
+    std::vector<bool> aliases(hiveCount, false);
+    if (options.noDedup) {
+        return aliases;
+    }
+    std::vector<std::wstring> roots;
+    for (size_t i = 0; i < hiveCount; i++) {
+        RegKey root(state.backend, hives[i].key, L"", 0);
+        roots.push_back(root.getPhysicalName());
+    }
+    for (size_t i = 0; i < hiveCount; i++) {
+        bool named = false;
+        for (const std::wstring& glob : options.includes) {
+            named = named || findHive(glob.substr(0, glob.find(L'\\'))) == &hives[i];
+        }
+        if (named) {
+            continue;
+        }
+        std::vector<std::wstring> parts;
+        if (hives[i].key == HKEY_CLASSES_ROOT) {
+            /* Software\\Classes of the user is a link to its classes hive */
+            RegKey machineClasses(state.backend, HKEY_LOCAL_MACHINE, L"SOFTWARE\\Classes", 1,
+                                  KEY_WOW64_64KEY, 0);
+            RegKey userClasses(state.backend, HKEY_CURRENT_USER, L"Software\\Classes", 1,
+                               KEY_WOW64_64KEY, 0);
+            parts.push_back(machineClasses.getPhysicalName());
+            parts.push_back(userClasses.getPhysicalName());
+        }
+        else {
+            parts.push_back(roots[i]);
+        }
+        bool covered = true;
+        for (const std::wstring& part : parts) {
+            bool partCovered = false;
+            for (size_t j = 0; j < hiveCount; j++) {
+                partCovered = partCovered || (j != i && !aliases[j] && isWithin(part, roots[j]));
+            }
+            covered = covered && partCovered;
+        }
+        aliases[i] = covered;
+    }
+    return aliases;
+}
+
+/**
+ * @fn  bool traverseHives(ScanState& state)
+ *
+ * @brief   Traverses every hive, starting from the checkpoint if there is one
+ *
+ * A traversal aborted by a registry error keeps a checkpoint at the key
+ * which failed, so it can be resumed like one which was stopped.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if it succeeds, false if a hive could not be opened or traversed.
+ */
+
+bool traverseHives(ScanState& state)
+{
+    const Options& options = state.options;
+    bool failed = false;
+    std::vector<bool> aliases = findAliases(state);
+    for (size_t i = 0; i < state.hive; i++) {
+        state.coverage[i] = 1;
+    }
+    for (size_t i = state.hive; i < hiveCount && !state.stopped; i++) {
+        state.hive = i;
+        state.progress.coverage.store(state.coverage[i], std::memory_order_relaxed);
+        state.progress.hive.store(i, std::memory_order_release);
+        if (aliases[i]) {
+            LOG(LOG_INFO) << "Skipping " << hives[i].name << ", it is a view of other hives\n";
+            state.coverage[i] = 1;
+            continue;
+        }
+        if (!state.backend.hasHive(hives[i].key)) {
+            state.coverage[i] = 1;
+            continue;
+        }
+        int filterState = 0;
+        if (!state.filter.isEmpty()) {
+            filterState = state.filter.advance(state.filter.start(), hives[i].name);
+            if (state.filter.prunes(filterState)) {
+                state.prunedKeys++;
+                state.coverage[i] = 1;
+                continue;
+            }
+        }
+        RegKey root(state.backend, hives[i].key, L"", 0);
+        if (!root.isValid()) {
+            failed = true;
+            break;
+        }
+        root.setHive(hives[i].name);
+        countHandle(state);
+        state.openPath.push_back(&root);
+        {
+            PhaseSpan span(PHASE_HIVE, hives[i].name);
+            failed = !iter(&root, state, 1, filterState);
+        }
+        state.openPath.clear();
+        closeHandle(state, &root);
+        if (state.stopped || failed) {
+            break;
+        }
+        state.position.clear();
+        state.resuming = false;
+    }
+    if (!state.stopped && !failed) {
+        /* The whole registry was traversed, nothing is left to resume */
+        DeleteFile(options.checkpointFile.c_str());
+    }
+    else if (options.checkpointInterval > 0 && !writeCheckpoint(state)) {
+        LOG(LOG_ERROR) << "Error: unable to write checkpoint " << options.checkpointFile << "\n";
+    }
+
+    if (!state.filter.isEmpty()) {
+        LOG(LOG_INFO) << "Pruned subtrees: " << state.prunedKeys << "\n";
+    }
+    LOG(LOG_INFO) << "Symbolic links (not followed): " << state.links.size() << "\n";
+    for (const std::pair<std::wstring, std::wstring>& link : state.links) {
+        LOG(LOG_INFO) << "  " << link.first << " -> " << link.second << "\n";
+    }
+    if (state.duplicateKeys > 0) {
+        LOG(LOG_INFO) << "Keys skipped as already visited: " << state.duplicateKeys << "\n";
+    }
+    /* A lower budget trades memory for reopens, this shows how much */
+    LOG(LOG_INFO) << "Key handles: peak " << state.peakHandles << ", reopened " <<
+                  state.handleReopens << " times";
+    if (options.maxHandles > 0) {
+        LOG(LOG_INFO) << " (budget " << options.maxHandles << ")";
+    }
+    LOG(LOG_INFO) << "\n";
+    if (options.deadline > 0) {
+        LOG(LOG_INFO) << (state.stopped ? "Deadline reached, partial results after " :
+                          "Finished before the deadline after ") << state.keysVisited << " keys\n";
+        for (size_t i = 0; i < hiveCount; i++) {
+            LOG(LOG_INFO) << hives[i].name << ": " << std::min(state.coverage[i], 1.0) * 100 <<
+                          "% covered\n";
+        }
+    }
+    return !failed;
+}
+
+/**
+ * @fn  bool prepareScan(ScanState& state)
+ *
+ * @brief   Sets the deadline, loads the checkpoint if resuming and opens the output files
+ *
+ * The match report and the folded stacks of a resumed run are continued.
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if it succeeds, false if an output file could not be opened.
+ */
+
+bool prepareScan(ScanState& state)
+{
+    const Options& options = state.options;
+    state.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.deadline);
+    state.coverage.assign(hiveCount, 0);
+    bool resumed = false;
+    if (options.resume) {
+        if ((resumed = readCheckpoint(state))) {
+            LOG(LOG_INFO) << "Resuming from checkpoint after " << state.keysVisited << " keys\n";
+        }
+        else {
+            LOG(LOG_INFO) << "No usable checkpoint found, starting over\n";
+        }
+    }
+    if (!options.reportFile.empty() &&
+        !state.report.open(options.reportFile, resumed)) {
+        LOG(LOG_ERROR) << "Error: unable to create " << options.reportFile << "\n";
+        return false;
+    }
+    if (!state.folded.open(options.foldedFile, options.foldedCallsFile, resumed)) {
+        LOG(LOG_ERROR) << "Error: unable to create the folded stacks\n";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @fn  bool scanRegistry(ScanState& state)
+ *
+ * @brief   Processes the known locations and traverses the hives as the options ask
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ *
+ * @return  True if it succeeds, false if it fails.
+ */
+
+bool scanRegistry(ScanState& state)
+{
+    const Options& options = state.options;
+    MetricsExporter exporter(state);
+    ProgressReporter reporter(state);
+    if (options.fast) {
+        if (!processKnownLocations(state)) {
+            return false;
+        }
+        /* A remote full traversal stays in this process, it is already off the machine */
+        if (options.deferFull && options.targets.empty() && !startDeferredTraversal(options)) {
+            LOG(LOG_ERROR) << "Error: unable to start the background traversal\n";
+        }
+    }
+    return (options.fast && !options.full) || traverseHives(state);
+}
+
+/**
+ * @fn  void printResults(ScanState& state)
+ *
+ * @brief   Prints the number of results and the cost of the scan
+ *
+ * @date    2026.10.16.
+ *
+ * @param [in,out]  state   The state of the traversal.
+ */
+
+void printResults(ScanState& state)
+{
+    logger.flush();
+    std::wcout << "Number of results: " << state.count << "\n";
+    if (state.deniedWrites > 0) {
+        std::wcout << "Not replaced, write access denied: " << state.deniedWrites << "\n";
     }
-
-    TCHAR* getName()
-    {
-        return name;
+    if (state.report.isOpen()) {
+        std::wcout << "Matches reported to " << state.options.reportFile << ": " <<
+                   state.report.getRecords() << "\n";
+        if (!state.report.close()) {
+            std::wcout << "Error: unable to write " << state.options.reportFile << "\n";
+        }
     }
-
-    HKEY getKey()
-    {
-        return key;
+    if (state.folded.isOpen() && !state.folded.close()) {
+        std::wcout << "Error: unable to write the folded stacks\n";
     }
+    std::wcout << "Registry API calls: " << state.backend.getCallCount() << " (" <<
+               (double)state.backend.getCallCount() / std::max(state.keysVisited, 1ULL) <<
+               " per key)\n";
+    state.backend.printStatistics();
+}
 
-    DWORD getSubkeyCount()
-    {
-        return subkeyCount;
-    }
+/**
+ * @fn  std::unique_ptr<RegistryBackend> record(std::unique_ptr<RegistryBackend> backend,
+ *                                              const std::wstring& fileName)
+ *
+ * @brief   Records the calls made to a backend if a trace file is given
+ *
+ * @date    2026.10.16.
+ *
+ * @param   backend     The backend to record.
+ * @param   fileName    The trace file, empty for no recording.
+ *
+ * @return  The backend to use, or null if the trace file could not be created.
+ */
 
-    DWORD getValueCount()
-    {
-        return valueCount;
+std::unique_ptr<RegistryBackend> record(std::unique_ptr<RegistryBackend> backend,
+                                        const std::wstring& fileName)
+{
+    if (fileName.empty()) {
+        return backend;
+    }
+    std::unique_ptr<RecordingBackend> recorder(new RecordingBackend(std::move(backend)));
+    if (!recorder->open(fileName)) {
+        std::wcout << "Error: unable to create " << fileName << "\n";
+        return NULL;
     }
+    return recorder;
+}
 
-    DWORD getLongestValueData()
-    {
-        return longestValueData;
+/**
+ * @fn  std::unique_ptr<RegistryBackend> instrument(std::unique_ptr<RegistryBackend> backend,
+ *                                                  const std::wstring& fileName)
+ *
+ * @brief   Counts and times the calls made to a backend
+ *
+ * @date    2026.10.16.
+ *
+ * @param   backend     The backend to instrument, may be null.
+ * @param   fileName    File the statistics are written to, empty for none.
+ *
+ * @return  The backend to use, or null if the backend is null.
+ */
+
+std::unique_ptr<RegistryBackend> instrument(std::unique_ptr<RegistryBackend> backend,
+                                            const std::wstring& fileName)
+{
+    if (!backend) {
+        return NULL;
     }
+    return std::unique_ptr<RegistryBackend>(new InstrumentedBackend(std::move(backend), fileName));
+}
 
-    /**
-     * @fn  bool isValid()
-     *
-     * @brief   Query whether the key was successfully opened
-     *
-     * @date    2018.03.16.
-     *
-     * @return  True if valid, false if not.
-     */
+/**
+ * @fn  std::unique_ptr<RegistryBackend> injectFaults(std::unique_ptr<RegistryBackend> backend,
+ *                                                    const std::wstring& spec, unsigned int seed)
+ *
+ * @brief   Injects delays and errors into the calls made to a backend if a profile is given
+ *
+ * @date    2026.10.16.
+ *
+ * @param   backend The backend to make slower and less reliable.
+ * @param   spec    The fault profile, see parseFaultProfile, empty for none.
+ * @param   seed    Seed of the faults, 0 picks a random seed.
+ *
+ * @return  The backend to use.
+ */
 
-    bool isValid()
-    {
-        return isValidb;
+std::unique_ptr<RegistryBackend> injectFaults(std::unique_ptr<RegistryBackend> backend,
+                                              const std::wstring& spec, unsigned int seed)
+{
+    FaultProfile profile;
+    if (spec.empty() || !parseFaultProfile(spec, profile)) {
+        return backend;
     }
+    return std::unique_ptr<RegistryBackend>(new FaultBackend(std::move(backend), profile, seed));
+}
 
-    /**
-     * @fn  int getDepth()
-     *
-     * @brief   Retrieves the current distance from the root of the hive
-     *
-     * @date    2018.03.16.
-     *
-     * @return  The depth from the root of the hive
-     */
+/**
+ * @fn  std::unique_ptr<RegistryBackend> openRegistry(const Options& options)
+ *
+ * @brief   Opens the registry a local scan reads
+ *
+ * @date    2026.10.16.
+ *
+ * @param   options The command line settings.
+ *
+ * @return  The local registry or the replayed trace, or null if it is not available.
+ */
 
-    int getDepth()
-    {
-        return depth;
+std::unique_ptr<RegistryBackend> openRegistry(const Options& options)
+{
+    std::unique_ptr<RegistryBackend> backend;
+    if (!options.replayFile.empty()) {
+        std::unique_ptr<ReplayBackend> replay(new ReplayBackend(options.replayTiming));
+        if (!replay->load(options.replayFile)) {
+            std::wcout << "Error: unable to load the trace " << options.replayFile << "\n";
+            return NULL;
+        }
+        backend = std::move(replay);
+    }
+    else {
+#ifdef _WIN32
+        backend.reset(new Win32Backend());
+#else
+        std::wcout << "Error: only --replay is available on this platform\n";
+        return NULL;
+#endif
     }
+    return backend;
+}
 
-    DWORD getErrorCode()
-    {
-        return errorCode;
+/**
+ * @fn  std::unique_ptr<RegistryBackend> createBackend(const Options& options)
+ *
+ * @brief   Creates the backend of a local scan
+ *
+ * The faults are injected below the recording, so the trace holds the
+ * calls as the traversal saw them.
+ *
+ * @date    2026.10.16.
+ *
+ * @param   options The command line settings.
+ *
+ * @return  The backend, or null if it is not available.
+ */
+
+std::unique_ptr<RegistryBackend> createBackend(const Options& options)
+{
+    std::unique_ptr<RegistryBackend> backend = openRegistry(options);
+    if (!backend) {
+        return NULL;
     }
+    return instrument(record(injectFaults(std::move(backend), options.faults, options.seed),
+                             options.recordFile), options.callStatsFile);
+}
+
+/**
+ * @struct  BenchmarkProfile
+ *
+ * @brief   Faults the traversal is measured under.
+ */
+
+struct BenchmarkProfile {
+    const wchar_t* name;
+    const wchar_t* faults;
+    /** @brief  Number of siblings opened ahead, negative for the default */
+    int prefetch;
 };
 
 /**
- * @fn  std::wstring Replace(const std::wstring& haystack, const std::wstring& needle,
- *                           const std::wstring& replacement)
+ * @fn  int runBenchmark(const Options& options)
  *
- * @brief   Replaces all occurences of the needle in the haystack.
+ * @brief   Measures the throughput and the tail latency of the traversal under each fault profile
  *
- * Does not modify the original string.
+ * Every profile runs the scan the options describe from scratch, without
+ * replacing anything, checkpointing or recording. The output of the
+ * traversal is suppressed, one line is printed per profile. The latencies
+ * are those of the calls as the traversal saw them, delays included.
  *
- * @date    2018.03.16.
+ * @date    2026.10.16.
  *
- * @param   haystack    The whole original string.
- * @param   needle      The string to be replaced.
- * @param   replacement The replacement.
+ * @param   options The command line settings, --inject replaces the built-in profiles.
  *
- * @return  A std::wstring containing the replaced string.
+ * @return  The number of profiles under which the scan failed, -1 if the registry is not available.
  */
 
-std::wstring Replace(const std::wstring& haystack, const std::wstring& needle,
-                     const std::wstring& replacement)
+int runBenchmark(const Options& options)
 {
-    std::wstring value = haystack;
-    size_t pos = 0;
+    static const BenchmarkProfile builtIn[] = BENCHMARK_PROFILES;
+    std::vector<BenchmarkProfile> profiles(builtIn, builtIn + sizeof(builtIn) / sizeof(builtIn[0]));
+    if (!options.faults.empty()) {
+        profiles.assign(1, BenchmarkProfile{ L"custom", options.faults.c_str(), -1 });
+    }
+    Options runOptions = options;
+    runOptions.readOnly = true;
+    runOptions.resume = false;
+    runOptions.checkpointInterval = 0;
+    /* A finished traversal deletes its checkpoint, the one of the user is left alone */
+    runOptions.checkpointFile.clear();
+    runOptions.recordFile.clear();
+    runOptions.reportFile.clear();
+    runOptions.foldedFile.clear();
+    runOptions.foldedCallsFile.clear();
+    runOptions.deferFull = false;
+    runOptions.progress = false;
+    runOptions.metricsFile.clear();
+    int failures = 0;
+    std::streamsize precision = std::wcout.precision();
+    std::wcout << "profile          keys     seconds   keys/s    calls/s   p50 us    p99 us    "
+               "p99.9 us  max us    faults    result\n";
+    for (const BenchmarkProfile& profile : profiles) {
+        std::unique_ptr<RegistryBackend> registry = openRegistry(options);
+        if (!registry) {
+            return -1;
+        }
+        FaultProfile faults;
+        parseFaultProfile(profile.faults, faults);
+        FaultBackend backend(std::move(registry), faults, options.seed);
+        runOptions.prefetch = (options.prefetch >= 0) ? options.prefetch : profile.prefetch;
+        ScanState state(runOptions, backend);
+        if (!prepareScan(state)) {
+            return -1;
+        }
+        logger.flush();
+        LogLevel level = logger.getLevel();
+        logger.setLevel(LOG_OFF);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool succeeded = scanRegistry(state);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                         start).count();
+        logger.setLevel(level);
+        if (!succeeded) {
+            failures++;
+        }
+        seconds = std::max(seconds, 1e-9);
+        std::wcout << std::left << std::setw(15) << profile.name << std::right << std::fixed <<
+                   std::setprecision(1) << std::setw(6) << state.keysVisited << std::setw(12) <<
+                   std::setprecision(3) << seconds << std::setprecision(0) << std::setw(9) <<
+                   state.keysVisited / seconds << std::setw(11) << backend.getCallCount() / seconds <<
+                   std::setprecision(1) << std::setw(10) << backend.latencyPercentile(50) <<
+                   std::setw(10) << backend.latencyPercentile(99) << std::setw(10) <<
+                   backend.latencyPercentile(99.9) << std::setw(10) << backend.getMaxLatency() <<
+                   std::setw(10) << backend.getInjected() << "    " << (succeeded ? "ok" : "failed") <<
+                   std::defaultfloat << std::setprecision(precision) << "\n";
+    }
+    return failures;
+}
 
-    while (true) {
-        pos = value.find(needle, pos);
-        if (pos == std::wstring::npos)
-            break;
+/**
+ * @fn  void scanTargets(const Options& options, std::atomic<size_t>& next, std::mutex& output,
+ *                       std::atomic<int>& failures)
+ *
+ * @brief   Scans remote machines until none is left. Body of the target threads.
+ *
+ * Every target has its own connection, state, checkpoint file and trace.
+ *
+ * @date    2026.10.16.
+ *
+ * @param           options     The command line settings.
+ * @param [in,out]  next        Index of the next target to scan.
+ * @param [in,out]  output      Keeps the results of the targets apart.
+ * @param [in,out]  failures    Incremented for every target which failed.
+ */
 
-        value.replace(pos, needle.length(), replacement);
-        pos += replacement.length();
+#ifdef _WIN32
+void scanTargets(const Options& options, std::atomic<size_t>& next, std::mutex& output,
+                 std::atomic<int>& failures)
+{
+    timeline.nameThread("targets");
+    for (size_t i = next++; i < options.targets.size(); i = next++) {
+        const std::wstring& target = options.targets[i];
+        Options targetOptions = options;
+        targetOptions.target = target;
+        /* Every simulated target is the local registry, which a simulation must not change */
+        targetOptions.readOnly = targetOptions.readOnly || options.simulatedLatency > 0;
+        targetOptions.checkpointFile += L"." + target;
+        if (!options.metricsFile.empty()) {
+            targetOptions.metricsFile = insertBeforeExtension(options.metricsFile, target);
+        }
+        for (std::wstring* fileName : { &targetOptions.reportFile, &targetOptions.foldedFile,
+                                        &targetOptions.foldedCallsFile
+                                      }) {
+            if (!fileName->empty()) {
+                *fileName += L"." + target;
+            }
+        }
+        std::unique_ptr<RemoteBackend> remote(new RemoteBackend(target, options.simulatedLatency > 0));
+        if (remote->getConnectError() != ERROR_SUCCESS) {
+            std::lock_guard<std::mutex> lock(output);
+            std::wcout << "Error: unable to connect to " << target << ": " <<
+                       remote->getConnectError() << "\n";
+            failures++;
+            continue;
+        }
+        std::wstring faults = options.faults;
+        if (options.simulatedLatency > 0) {
+            faults = L"*=delay:" + std::to_wstring(options.simulatedLatency) +
+                     (faults.empty() ? L"" : L",") + faults;
+        }
+        std::unique_ptr<RegistryBackend> backend = record(injectFaults(std::move(remote), faults,
+                                                          options.seed),
+                                                          options.recordFile.empty() ? std::wstring() :
+                                                          options.recordFile + L"." + target);
+        backend = instrument(std::move(backend), options.callStatsFile.empty() ? std::wstring() :
+                             options.callStatsFile + L"." + target);
+        if (!backend) {
+            failures++;
+            continue;
+        }
+        ScanState state(targetOptions, *backend);
+        bool succeeded = prepareScan(state) && scanRegistry(state);
+        std::lock_guard<std::mutex> lock(output);
+        logger.flush();
+        std::wcout << "Results for " << target << (succeeded ? ":\n" : " (failed):\n");
+        printResults(state);
+        if (!succeeded) {
+            failures++;
+        }
     }
+}
 
-    return value;
+/**
+ * @fn  int scanRemote(const Options& options)
+ *
+ * @brief   Scans the registry of the target machines, several at the same time
+ *
+ * @date    2026.10.16.
+ *
+ * @param   options The command line settings.
+ *
+ * @return  The number of targets which failed.
+ */
+
+int scanRemote(const Options& options)
+{
+    std::atomic<size_t> next(0);
+    std::atomic<int> failures(0);
+    std::mutex output;
+    std::vector<std::thread> threads;
+    size_t threadCount = std::min((size_t)std::max(options.concurrentTargets, 1),
+                                  options.targets.size());
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.push_back(std::thread(scanTargets, std::cref(options), std::ref(next),
+                                      std::ref(output), std::ref(failures)));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return failures;
 }
+#endif
 
 /**
- * @fn  bool iter(RegKey *keyHolder, int& count)
+ * @fn  void printUsage()
  *
- * @brief   Iterates over the subkeys and prints the values of the key. Recursive function.
+ * @brief   Prints the accepted command line arguments
  *
- * If it finds a matching value it replaces the home directory
- * information in the value.
- * Note: The extensive use of heap memory is to avoid stack overflow.
+ * @date    2026.10.16.
+ */
+
+void printUsage()
+{
+    std::wcout << "Usage: move_homedir [options]\n"
+               "  --resume                     continue from the last checkpoint\n"
+               "  --checkpoint <file>          checkpoint file (default: " << CHECKPOINT_FILE << ")\n"
+               "  --checkpoint-interval <sec>  seconds between checkpoints, 0 disables them\n"
+               "  --background                 lower the priority and limit the CPU use to " <<
+               BACKGROUND_CPU_PERCENT << "% of a core\n"
+               "  --keys-per-second <n>        limit the number of keys opened per second\n"
+               "  --cpu-percent <n>            limit the CPU use to n% of a core\n"
+               "  --deadline <sec>             stop after the given time and report the coverage\n"
+               "  --sample <n>                 estimate the number of results from n random\n"
+               "                               paths per hive without replacing anything\n"
+               "  --seed <n>                   seed of the sampling\n"
+               "  --fast                       only process the known locations\n"
+               "  --locations <file>           known locations (default: " << LOCATIONS_FILE <<
+               " next to the executable)\n"
+               "  --full                       traverse the whole registry after the known locations\n"
+               "  --defer-full                 traverse the whole registry in a background process\n"
+               "                               with the same arguments (requires --fast); its output\n"
+               "                               files are named <file>.deferred, the metrics\n"
+               "                               <name>.deferred.prom\n"
+               "  --include <glob>             only traverse the matching subtrees, e.g.\n"
+               "                               HKU\\*\\Software\\**\\Explorer (repeatable)\n"
+               "  --exclude <glob>             skip the matching subtrees, e.g.\n"
+               "                               HKLM\\SOFTWARE\\Classes\\CLSID (repeatable)\n"
+               "  --no-dedup                   also traverse the hives which are views of\n"
+               "                               other hives, and keys reached a second way\n"
+               "  --wow64                      also cover the 32-bit view of the known locations\n"
+               "                               and of the include and exclude globs\n"
+               "  --max-handles <n>            keep at most n key handles open, ancestors are\n"
+               "                               closed and reopened by path as needed\n"
+               "  --enumeration <info|probe>   query the size of every key before enumerating it,\n"
+               "                               or enumerate until the end (default: probe)\n"
+               "  --prefetch <n>               open the next n siblings on helper threads while\n"
+               "                               a subtree is traversed (default: 0, remote: " <<
+               REMOTE_WINDOW << ")\n"
+               "  --remote <machine>           scan HKLM and HKU of the machine instead of the\n"
+               "                               local registry (repeatable)\n"
+               "  --concurrent-targets <n>     number of machines scanned at the same time\n"
+               "                               (default: " << CONCURRENT_TARGETS << ")\n"
+               "  --simulate-latency <ms>      serve the remote targets from the local registry,\n"
+               "                               delaying every call by the given time, read only\n"
+               "  --inject <profile>           inject delays and errors into the registry calls,\n"
+               "                               e.g. open=lognormal:1:1.5,enumkey=denied:0.01:50;\n"
+               "                               calls: open close info enumkey enumvalue getvalue\n"
+               "                               setvalue name *; effects: delay:<ms> exp:<mean ms>\n"
+               "                               lognormal:<median ms>:<sigma> denied:<rate>[:<calls>]\n"
+               "                               moredata:<rate> changed:<rate>\n"
+               "  --benchmark                  measure the scan under built-in fault profiles (or\n"
+               "                               the --inject profile) without replacing anything\n"
+               "  --call-stats <file>          write the count, errors and latency histogram of\n"
+               "                               every kind of registry call as JSON\n"
+               "                               (one file per remote target: <file>.<machine>)\n"
+               "  --report <file>              write one JSON line per match with the full path,\n"
+               "                               the old and new value, the outcome and the time\n"
+               "  --timeline <file>            write the phases of the scan per thread as Chrome\n"
+               "                               trace events, for chrome://tracing or Perfetto\n"
+               "  --folded <file>              write the time spent per key path as folded stacks\n"
+               "                               for flame graphs\n"
+               "  --folded-calls <file>        write the registry calls per key path as folded\n"
+               "                               stacks for flame graphs\n"
+               "  --top <k>                    print the k slowest key opens, enumerations and\n"
+               "                               value reads with their paths and sizes\n"
+               "  --progress                   print the rates, the bytes scanned, the matches\n"
+               "                               and the time left in the hive on the standard error\n"
+               "  --metrics <file>             write the counters, errors, call latencies and peak\n"
+               "                               memory as a Prometheus text file, replaced atomically\n"
+               "                               (one file per remote target: <name>.<machine>.prom)\n"
+               "  --metrics-interval <sec>     seconds between two writes of the metrics\n"
+               "                               (default: 15)\n"
+               "  --log <file>                 write the messages to a UTF-8 file instead of the\n"
+               "                               console\n"
+               "  --log-level <level>          off, error, warning, info (default: replacements\n"
+               "                               and summaries), debug (every key and value) or\n"
+               "                               trace (diagnostics of builds with TRACE_ENABLED)\n"
+               "  --record <file>              record every registry call to a trace file\n"
+               "                               (one file per remote target: <file>.<machine>)\n"
+               "  --replay <file>              answer the registry calls from a recorded trace\n"
+               "  --replay-timing              take as long as the recorded calls took\n";
+}
+
+/**
+ * @fn  bool parseArguments(int argc, TCHAR* argv[], Options& options)
  *
- * @date    2018.03.16.
+ * @brief   Processes the command line arguments
  *
- * @param [in,out]  keyHolder   If non-null, the key holder.
- * @param [in,out]  count       Number of values which match.
+ * @date    2026.10.16.
  *
- * @return  True if it succeeds, false if it fails.
+ * @param           argc    Number of command line arguments.
+ * @param           argv    The command line arguments.
+ * @param [out]     options The settings parsed from the arguments.
+ *
+ * @return  True if it succeeds, false if an argument is not recognized.
  */
 
-bool iter(RegKey *keyHolder, int& count)
+bool parseArguments(int argc, TCHAR* argv[], Options& options)
 {
-    DWORD errValue;
-    std::wcout << "Iterating through (" << keyHolder->getDepth() << ") " <<
-               keyHolder->getName() << ":\n";
-    for (DWORD i = 0; i < keyHolder->getSubkeyCount(); i++) {
-        DWORD maxKeyName = MAX_KEY_LENGTH;
-        TCHAR *keyName = new TCHAR[MAX_KEY_LENGTH];
-        FILETIME lastWriteTime;
-        if ((errValue = RegEnumKeyEx(keyHolder->getKey(), i, keyName, &maxKeyName, NULL,
-                                     NULL, NULL, &lastWriteTime)) != ERROR_SUCCESS) {
-            std::wcout << "Error: " << errValue << "\n";
-            delete keyName;
-            return false;
+    options.arguments.assign(argv + 1, argv + argc);
+    for (int i = 1; i < argc; i++) {
+        std::wstring argument = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (argument == L"--resume") {
+            options.resume = true;
         }
-        RegKey *subKey = new RegKey(keyHolder->getKey(), keyName,
-                                    keyHolder->getDepth() + 1);
-        /* This is to workaround registry virtualization */
-        if (!subKey->isValid() && subKey->getErrorCode() != ERROR_FILE_NOT_FOUND) {
-            if (DEBUG || subKey->getErrorCode() != ERROR_ACCESS_DENIED) {
-                std::wcout << "Error: creation of subkey " << keyName << "\n";
-            }
-            /* Access denial should not be a problem here */
-            if (subKey->getErrorCode() != ERROR_ACCESS_DENIED) {
-                delete keyName;
-                delete subKey;
+        else if (argument == L"--checkpoint" && hasValue) {
+            options.checkpointFile = argv[++i];
+        }
+        else if (argument == L"--checkpoint-interval" && hasValue) {
+            options.checkpointInterval = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--background") {
+            options.background = true;
+        }
+        else if (argument == L"--keys-per-second" && hasValue) {
+            options.keysPerSecond = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--cpu-percent" && hasValue) {
+            options.cpuPercent = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--deadline" && hasValue) {
+            options.deadline = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--sample" && hasValue) {
+            options.samples = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--seed" && hasValue) {
+            options.seed = (unsigned int)_ttoi(argv[++i]);
+        }
+        else if (argument == L"--fast") {
+            options.fast = true;
+        }
+        else if (argument == L"--locations" && hasValue) {
+            options.locationsFile = argv[++i];
+        }
+        else if (argument == L"--full") {
+            options.full = true;
+        }
+        else if (argument == L"--defer-full") {
+            options.deferFull = true;
+        }
+        else if (argument == L"--include" && hasValue) {
+            options.includes.push_back(argv[++i]);
+        }
+        else if (argument == L"--exclude" && hasValue) {
+            options.excludes.push_back(argv[++i]);
+        }
+        else if (argument == L"--no-dedup") {
+            options.noDedup = true;
+        }
+        else if (argument == L"--wow64") {
+            options.wow64 = true;
+        }
+        else if (argument == L"--max-handles" && hasValue) {
+            options.maxHandles = (unsigned long)_ttoi(argv[++i]);
+        }
+        else if (argument == L"--prefetch" && hasValue) {
+            options.prefetch = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--remote" && hasValue) {
+            options.targets.push_back(argv[++i]);
+        }
+        else if (argument == L"--concurrent-targets" && hasValue) {
+            options.concurrentTargets = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--simulate-latency" && hasValue) {
+            options.simulatedLatency = _ttoi(argv[++i]);
+        }
+        else if (argument == L"--inject" && hasValue) {
+            FaultProfile profile;
+            options.faults = argv[++i];
+            if (!parseFaultProfile(options.faults, profile)) {
+                std::wcout << "Invalid fault profile: " << options.faults << "\n";
                 return false;
             }
         }
-        std::wcout << i << ": " << keyName << "\n";
-        /* Only iterate through the key if it's valid */
-        if (subKey->isValid() && !iter(subKey, count)) {
-            delete keyName;
-            delete subKey;
-            return false;
+        else if (argument == L"--benchmark") {
+            options.benchmark = true;
         }
-        delete keyName;
-        delete subKey;
-    }
-    std::wcout << "Values for class " << keyHolder->getName() << ":\n";
-    for (DWORD i = 0; i < keyHolder->getValueCount(); i++) {
-        DWORD maxKeyValue = MAX_VALUE_NAME;
-        TCHAR* valueName = new TCHAR[MAX_VALUE_NAME];
-        if ((errValue = RegEnumValue(keyHolder->getKey(), i, valueName, &maxKeyValue,
-                                     NULL, NULL, NULL, NULL)) != ERROR_SUCCESS) {
-            std::wcout << "Error: " << errValue << "\n";
-            delete valueName;
-            return false;
+        else if (argument == L"--call-stats" && hasValue) {
+            options.callStatsFile = argv[++i];
         }
-        std::wcout << i << ": " << valueName << "\n";
-        /* We do not know the size of the value to be retrieved, so assume the worst */
-        TCHAR *data = new TCHAR[keyHolder->getLongestValueData() * 2 + 2];
-        memset(data, 0, keyHolder->getLongestValueData() * 2 + 2);
-        DWORD type, size = keyHolder->getLongestValueData() * 2 + 2;
-        if ((errValue = RegGetValue(keyHolder->getKey(), NULL, valueName, RRF_RT_REG_SZ,
-                                    &type, data, &size)) != ERROR_SUCCESS) {
-            /* Unsupported type only means we encountered a non-string value */
-            if (errValue != ERROR_UNSUPPORTED_TYPE) {
-                if (errValue == ERROR_MORE_DATA) {
-                    std::wcout << "Maximum length: " << keyHolder->getLongestValueData() << "\n";
-                }
-                std::wcout << "Error during value retrival: " << errValue << "\n";
-                delete data;
-                delete valueName;
+        else if (argument == L"--report" && hasValue) {
+            options.reportFile = argv[++i];
+        }
+        else if (argument == L"--timeline" && hasValue) {
+            options.timelineFile = argv[++i];
+        }
+        else if (argument == L"--folded" && hasValue) {
+            options.foldedFile = argv[++i];
+        }
+        else if (argument == L"--folded-calls" && hasValue) {
+            options.foldedCallsFile = argv[++i];
+        }
+        else if (argument == L"--top" && hasValue) {
+            options.top = std::max(_ttoi(argv[++i]), 0);
+        }
+        else if (argument == L"--progress") {
+            options.progress = true;
+        }
+        else if (argument == L"--metrics" && hasValue) {
+            options.metricsFile = argv[++i];
+        }
+        else if (argument == L"--metrics-interval" && hasValue) {
+            options.metricsInterval = std::max(_ttoi(argv[++i]), 1);
+        }
+        else if (argument == L"--log" && hasValue) {
+            options.logFile = argv[++i];
+        }
+        else if (argument == L"--log-level" && hasValue) {
+            static const wchar_t* levels[] = { L"off", L"error", L"warning", L"info", L"debug",
+                                               L"trace"
+                                             };
+            std::wstring name = argv[++i];
+            const wchar_t** found = std::find(levels, levels + LOG_TRACE + 1, name);
+            if (found == levels + LOG_TRACE + 1) {
+                std::wcout << "Unknown log level: " << name << "\n";
                 return false;
             }
+            options.logLevel = (LogLevel)(found - levels);
         }
-        if (errValue == ERROR_SUCCESS) {
-            /*Only replace the string if it matches what we search for */
-            if (wcsstr(data, FROM_NAME) != NULL) {
-                count++;
-                std::wcout << "key: " << keyHolder->getName() << " valueName: " << i << ": " <<
-                           valueName << "\n";
-                std::wstring replaced(data);
-                replaced = Replace(replaced, FROM_NAME, TO_NAME);
-                std::wcout << i << " value: " << data << "\n";
-                std::wcout << i << " new value: " << replaced << "\n";
-                DWORD setRes = RegSetValueEx(keyHolder->getKey(), valueName, 0, REG_SZ,
-                                             (LPBYTE)replaced.c_str(),
-                                             ((DWORD)replaced.length() + 1) * (DWORD)sizeof(WCHAR));
-                if (setRes != ERROR_SUCCESS) {
-                    delete valueName;
-                    delete data;
-                    return false;
-                }
-            }
+        else if (argument == L"--record" && hasValue) {
+            options.recordFile = argv[++i];
+        }
+        else if (argument == L"--replay" && hasValue) {
+            options.replayFile = argv[++i];
+        }
+        else if (argument == L"--replay-timing") {
+            options.replayTiming = true;
+        }
+        else if (argument == L"--enumeration" && hasValue &&
+                 (std::wstring(argv[i + 1]) == L"info" || std::wstring(argv[i + 1]) == L"probe")) {
+            options.enumeration = argv[++i];
+        }
+        else {
+            std::wcout << "Unknown argument: " << argument << "\n";
+            return false;
         }
-        delete valueName;
-        delete data;
+    }
+    if (options.deferFull && !options.fast) {
+        std::wcout << "--defer-full requires --fast\n";
+        return false;
+    }
+    if (options.samples > 0 && !options.targets.empty()) {
+        std::wcout << "--sample is not supported with --remote\n";
+        return false;
     }
     return true;
 }
 
 /**
- * @fn  int main()
+ * @fn  int _tmain(int argc, TCHAR* argv[])
  *
  * @brief   Main entry-point for this application
  *
@@ -353,53 +7286,140 @@ bool iter(RegKey *keyHolder, int& count)
  *
  * @date    2018.03.16.
  *
+ * @param   argc    Number of command line arguments.
+ * @param   argv    The command line arguments.
+ *
  * @return  Exit-code for the process - 0 for success, else an error code.
  */
 
-int main()
+int _tmain(int argc, TCHAR* argv[])
 {
+#ifdef _WIN32
     //https://stackoverflow.com/questions/2492077/output-unicode-strings-in-windows-console-app
     _setmode(_fileno(stdout), _O_U16TEXT);
+#endif
 
-    /* Used to hold the values which match the replacement criterium */
-    int count = 0;
-
-    RegKey classesRoot(HKEY_CLASSES_ROOT, L"", 0);
-    if (!classesRoot.isValid()) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
         return -1;
     }
-    iter(&classesRoot, count);
-
-    RegKey currentUser(HKEY_CURRENT_USER, L"", 0);
-    if (!currentUser.isValid()) {
-        return -1;
+    if (options.background) {
+#ifdef _WIN32
+        /* Lowers the CPU, I/O and memory priority of the whole process */
+        SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN);
+#endif
+        if (options.keysPerSecond <= 0 && options.cpuPercent <= 0) {
+            options.cpuPercent = BACKGROUND_CPU_PERCENT;
+        }
     }
-    iter(&currentUser, count);
-
-    RegKey localMachine(HKEY_LOCAL_MACHINE, L"", 0);
-    if (!localMachine.isValid()) {
-        return -1;
+    if (!options.timelineFile.empty()) {
+        timeline.enable();
     }
-    iter(&localMachine, count);
-
-    RegKey users(HKEY_USERS, L"", 0);
-    if (!users.isValid()) {
+    slowest.enable(options.top);
+    if (!logger.start(options.logLevel, options.logFile)) {
+        std::wcout << "Error: unable to create " << options.logFile << "\n";
         return -1;
     }
-    iter(&users, count);
 
-    RegKey currentConfig(HKEY_CURRENT_CONFIG, L"", 0);
-    if (!currentConfig.isValid()) {
+    if (options.benchmark) {
+        if (runBenchmark(options) != 0) {
+            return -1;
+        }
+    }
+    else if (!options.targets.empty()) {
+#ifdef _WIN32
+        if (scanRemote(options) > 0) {
+            return -1;
+        }
+#else
+        std::wcout << "Error: remote scans are only available on Windows\n";
         return -1;
+#endif
     }
-    iter(&currentConfig, count);
+    else {
+        std::unique_ptr<RegistryBackend> backend = createBackend(options);
+        if (!backend) {
+            return -1;
+        }
+        /* Used to hold the values which match the replacement criterium */
+        ScanState state(options, *backend);
+        if (!prepareScan(state)) {
+            return -1;
+        }
+
+        if (options.samples > 0) {
+            std::mt19937 random(options.seed != 0 ? options.seed : std::random_device()());
+            double total = 0, variance = 0;
+            for (size_t i = 0; i < hiveCount; i++) {
+                double hiveMean, hiveVariance;
+                if (!sampleHive(hives[i].key, state, random, hiveMean, hiveVariance)) {
+                    return -1;
+                }
+                total += hiveMean;
+                variance += hiveVariance;
+            }
+            double margin = CONFIDENCE_Z * std::sqrt(variance);
+            logger.flush();
+            std::wcout << "Sampled " << state.keysVisited << " keys\n";
+            std::wcout << "Number of results: ~" << std::llround(total) <<
+                       " (95% confidence interval: " << std::llround(std::max(total - margin, 0.0)) <<
+                       " - " << std::llround(total + margin) << ", " << options.samples <<
+                       " samples per hive)\n";
+            return 0;
+        }
 
-    std::wcout << "Number of results: " << count << "\n";
+        if (!scanRegistry(state)) {
+            return -1;
+        }
+        printResults(state);
+    }
+    logger.flush();
+    if (slowest.isEnabled()) {
+        slowest.print();
+    }
+    if (!options.timelineFile.empty() && !timeline.write(options.timelineFile)) {
+        std::wcout << "Error: unable to write " << options.timelineFile << "\n";
+    }
     /* This is to ensure the program is also usable from the desktop */
+    std::wint_t key;
     do {
         std::wcout << '\n' << "Press the return key to continue...";
     }
-    while (std::wcin.get() != '\n');
+    while ((key = std::wcin.get()) != '\n' && key != WEOF);
 
     return 0;
-}
\ No newline at end of file
+}
+
+#ifndef _WIN32
+/**
+ * @fn  int main(int argc, char* argv[])
+ *
+ * @brief   Entry point outside Windows, passes the arguments on as wide strings
+ *
+ * @date    2026.10.16.
+ *
+ * @param   argc    Number of command line arguments.
+ * @param   argv    The command line arguments in the encoding of the locale.
+ *
+ * @return  Exit-code for the process - 0 for success, else an error code.
+ */
+
+int main(int argc, char* argv[])
+{
+    setlocale(LC_ALL, "");
+    std::vector<std::wstring> arguments;
+    for (int i = 0; i < argc; i++) {
+        std::wstring argument(strlen(argv[i]), L'\0');
+        size_t length = mbstowcs(&argument[0], argv[i], argument.size());
+        argument.resize(length == (size_t)-1 ? 0 : length);
+        arguments.push_back(argument);
+    }
+    std::vector<TCHAR*> pointers;
+    for (std::wstring& argument : arguments) {
+        pointers.push_back(&argument[0]);
+    }
+    pointers.push_back(NULL);
+    return wmain(argc, pointers.data());
+}
+#endif
\ No newline at end of file